@@ -198,6 +198,7 @@ PYBIND11_MODULE(_broker, m) {
     .def("fd", &subscriber_base::fd);
 
   py::class_<broker::subscriber, subscriber_base>(m, "Subscriber")
+    .def("dropped", &broker::subscriber::dropped)
     .def("add_topic", &broker::subscriber::add_topic)
     .def("remove_topic", &broker::subscriber::remove_topic);
 
@@ -250,6 +251,9 @@ PYBIND11_MODULE(_broker, m) {
     .def_readwrite("disable_ssl", &broker::broker_options::disable_ssl)
     .def_readwrite("ttl", &broker::broker_options::ttl)
     .def_readwrite("forward", &broker::broker_options::forward)
+    .def_readwrite("publisher_queue_size", &broker::broker_options::publisher_queue_size)
+    .def_readwrite("publisher_queue_max_size", &broker::broker_options::publisher_queue_max_size)
+    .def_readwrite("store_change_log_size", &broker::broker_options::store_change_log_size)
     .def_readwrite("ignore_broker_conf", &broker::broker_options::ignore_broker_conf)
     .def_readwrite("use_real_time", &broker::broker_options::use_real_time);
 
@@ -320,8 +324,10 @@ PYBIND11_MODULE(_broker, m) {
            xs.emplace_back(std::move(m.first), std::move(m.second));
          ep.publish(std::move(xs));
        })
-    .def("make_publisher", &broker::endpoint::make_publisher)
-    .def("make_subscriber", &broker::endpoint::make_subscriber, py::arg("topics"), py::arg("max_qsize") = 20)
+    .def("make_publisher", (broker::publisher (broker::endpoint::*)(broker::topic)) &broker::endpoint::make_publisher)
+    .def("make_subscriber", &broker::endpoint::make_subscriber, py::arg("topics"), py::arg("max_qsize") = 20,
+         py::arg("kind") = broker::queue_kind::locked,
+         py::arg("policy") = broker::overflow_policy::block)
     .def("make_status_subscriber", &broker::endpoint::make_status_subscriber, py::arg("receive_statuses") = false)
     .def("shutdown", &broker::endpoint::shutdown)
     .def("attach_master",
@@ -59,6 +59,8 @@ PeerStatus = _broker.PeerStatus
 PeerFlags = _broker.PeerFlags
 Frontend = _broker.Frontend
 Backend = _broker.Backend
+QueueKind = _broker.QueueKind
+OverflowPolicy = _broker.OverflowPolicy
 NetworkInfo = _broker.NetworkInfo
 EndpointInfo = _broker.EndpointInfo
 PeerInfo = _broker.PeerInfo
@@ -140,6 +142,9 @@ class Subscriber:
     def available(self):
         return self._subscriber.available()
 
+    def dropped(self):
+        return self._subscriber.dropped()
+
     def fd(self):
         return self._subscriber.fd()
 
@@ -321,9 +326,10 @@ class Store:
         return (_broker.OptionalTimespan(_broker.Timespan(float(e))) if e is not None else _broker.OptionalTimespan())
 
 class Endpoint(_broker.Endpoint):
-    def make_subscriber(self, topics, qsize = 20):
+    def make_subscriber(self, topics, qsize = 20, kind = QueueKind.Locked,
+                        policy = OverflowPolicy.Block):
         topics = _make_topics(topics)
-        s = _broker.Endpoint.make_subscriber(self, topics, qsize)
+        s = _broker.Endpoint.make_subscriber(self, topics, qsize, kind, policy)
         return Subscriber(s)
 
     def make_status_subscriber(self, receive_statuses=False):
@@ -10,8 +10,10 @@
 #include "broker/backend.hh"
 #include "broker/error.hh"
 #include "broker/frontend.hh"
+#include "broker/overflow_policy.hh"
 #include "broker/peer_flags.hh"
 #include "broker/peer_status.hh"
+#include "broker/queue_kind.hh"
 #include "broker/status.hh"
 
 namespace py = pybind11;
@@ -70,4 +72,16 @@ void init_enums(py::module& m) {
     .value("SQLite", broker::backend::sqlite)
     .value("RocksDB", broker::backend::rocksdb)
     .export_values();
+
+  py::enum_<broker::queue_kind>(m, "QueueKind")
+    .value("Locked", broker::queue_kind::locked)
+    .value("LockFree", broker::queue_kind::lock_free)
+    .export_values();
+
+  py::enum_<broker::overflow_policy>(m, "OverflowPolicy")
+    .value("Block", broker::overflow_policy::block)
+    .value("DropOldest", broker::overflow_policy::drop_oldest)
+    .value("DropNewest", broker::overflow_policy::drop_newest)
+    .value("Sample", broker::overflow_policy::sample)
+    .export_values();
 }
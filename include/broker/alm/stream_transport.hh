@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <random>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -13,6 +17,7 @@
 #include <caf/detail/scope_guard.hpp>
 #include <caf/fused_downstream_manager.hpp>
 #include <caf/fwd.hpp>
+#include <caf/inbound_path.hpp>
 #include <caf/message.hpp>
 #include <caf/sec.hpp>
 #include <caf/settings.hpp>
@@ -23,9 +28,15 @@
 #include "broker/data.hh"
 #include "broker/defaults.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/blocked_peer_buffer.hh"
+#include "broker/detail/core_stats.hh"
+#include "broker/detail/dedup_window.hh"
 #include "broker/detail/filesystem.hh"
 #include "broker/detail/generator_file_writer.hh"
+#include "broker/detail/indexed_downstream_manager.hh"
+#include "broker/detail/peer_downstream_manager.hh"
 #include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/topic_dictionary.hh"
 #include "broker/error.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal_command.hh"
@@ -69,8 +80,9 @@ public:
     using batch = std::vector<element>;
 
     /// Type of the downstream_manager that broadcasts data to local actors.
-    using manager = caf::broadcast_downstream_manager<element, filter_type,
-                                                      detail::prefix_matcher>;
+    using manager
+      = detail::indexed_downstream_manager<element, filter_type,
+                                           detail::prefix_matcher>;
   };
 
   /// Streaming-related types for workers.
@@ -91,9 +103,8 @@ public:
 
     using batch = std::vector<element>;
 
-    /// Type of the downstream_manager that broadcasts data to local actors.
-    using manager = caf::broadcast_downstream_manager<element, peer_filter,
-                                                      peer_filter_matcher>;
+    /// Type of the downstream_manager that broadcasts data to peers.
+    using manager = detail::peer_downstream_manager<PeerId>;
   };
 
   /// Composed downstream_manager type for bundled dispatching.
@@ -166,6 +177,21 @@ public:
     return out().template get<typename store_trait::manager>();
   }
 
+  /// Returns the window for detecting duplicates in peer traffic.
+  auto& dedup() noexcept {
+    return dedup_;
+  }
+
+  /// Returns the counters that this peer shares with its endpoint.
+  const detail::core_stats_ptr& stats() const noexcept {
+    return stats_;
+  }
+
+  /// Sets the counters that this peer shares with its endpoint.
+  void stats(detail::core_stats_ptr ptr) noexcept {
+    stats_ = std::move(ptr);
+  }
+
   // -- streaming helper functions ---------------------------------------------
 
   void ack_open_success(caf::stream_slot slot,
@@ -199,13 +225,13 @@ public:
 
   void push_to_substreams(std::vector<caf::message> xs) {
     // Dispatch on the content of `xs`.
+    // Note: get_mutable_as only copies the content of `x` if another message
+    //       shares it, i.e., we move the content out of unique messages.
     for (auto& x : xs) {
       if (x.match_elements<topic, data>()) {
-        x.force_unshare();
         worker_manager().push(std::move(x.get_mutable_as<topic>(0)),
                               std::move(x.get_mutable_as<data>(1)));
       } else if (x.match_elements<topic, internal_command>()) {
-        x.force_unshare();
         store_manager().push(std::move(x.get_mutable_as<topic>(0)),
                              std::move(x.get_mutable_as<internal_command>(1)));
       }
@@ -223,6 +249,7 @@ public:
 
   /// Block peer messages from being handled.  They are buffered until unblocked.
   void block_peer(caf::actor peer) {
+    blocked_buffer(peer);
     blocked_peers.emplace(std::move(peer));
   }
 
@@ -235,17 +262,27 @@ public:
     auto pit = hdl_to_istream_.find(peer);
     if (pit == hdl_to_istream_.end()) {
       blocked_msgs.erase(it);
+      update_blocked_stats();
       BROKER_DEBUG(
         "dropped batches after unblocking peer: path no longer exists" << peer);
       return;
     }
-    auto& slot = pit->second;
+    // Take the buffer out of the map, because handling a batch may remove
+    // the peer.
+    auto node = blocked_msgs.extract(it);
+    update_blocked_stats();
     auto sap = caf::actor_cast<caf::strong_actor_ptr>(peer);
-    for (auto& batch : it->second) {
+    auto f = [&](caf::message& batch) {
+      if (hdl_to_istream_.count(peer) == 0)
+        return;
       BROKER_DEBUG("handle blocked batch" << peer);
       handle_batch(sap, batch);
+    };
+    if (auto err = node.mapped().drain(f)) {
+      // Dropping the batches would leave gaps in the stream of the peer.
+      BROKER_ERROR("failed to read all blocked batches from" << peer << err);
+      remove_peer(peer, std::move(err), false, false);
     }
-    blocked_msgs.erase(it);
   }
 
   /// Disconnects a peer by demand of the user.
@@ -368,6 +405,9 @@ public:
         this->remove_input_path(i->second, reason, silent);
         istream_to_hdl_.erase(i->second);
         hdl_to_istream_.erase(i);
+        topic_decoders_.erase(hdl);
+        if (blocked_msgs.erase(hdl) != 0)
+          update_blocked_stats();
       }
     }
     if (performed_erases == 0) {
@@ -470,7 +510,8 @@ public:
   void remote_push(message_type msg) {
     BROKER_TRACE(BROKER_ARG(msg));
     peer_manager().push(std::move(msg));
-    peer_manager().emit_batches();
+    if (!bulk_publishing_)
+      peer_manager().emit_batches();
   }
 
   using caf::stream_manager::push;
@@ -478,14 +519,14 @@ public:
   /// Pushes data to peers and workers.
   void push(data_message msg) {
     BROKER_TRACE(BROKER_ARG(msg));
-    remote_push(make_node_message(std::move(msg), dref().options().ttl));
+    remote_push(make_initial_message(std::move(msg)));
     // local_push(std::move(x), std::move(y));
   }
 
   /// Pushes data to peers and stores.
   void push(command_message msg) {
     BROKER_TRACE(BROKER_ARG(msg));
-    remote_push(make_node_message(std::move(msg), dref().options().ttl));
+    remote_push(make_initial_message(std::move(msg)));
     // local_push(std::move(x), std::move(y));
   }
 
@@ -519,6 +560,25 @@ public:
     visit([this](auto& x) { dref().ship(x); }, msg);
   }
 
+  /// Publishes a command with routing flags, e.g., for store traffic that
+  /// peers must not forward.
+  void publish(command_message msg, node_message_flags flags) {
+    auto x = make_initial_message(std::move(msg), flags);
+    dref().ship(x);
+  }
+
+  /// Publishes all messages in `q`, a queue that local threads fill via the
+  /// endpoint. Emits batches to the peers only after draining the queue.
+  template <class Queue>
+  void publish_all(Queue& q) {
+    bulk_publishing_ = true;
+    auto n = q.drain([this](data_message&& x) { publish(std::move(x)); });
+    bulk_publishing_ = false;
+    BROKER_DEBUG("published" << n << "messages from the ingress queue");
+    if (n > 0)
+      peer_manager().emit_batches();
+  }
+
   // -- overridden member functions of caf::stream_manager ---------------------
 
   void handle_batch(const caf::strong_actor_ptr& hdl, caf::message& xs) {
@@ -545,8 +605,15 @@ public:
       auto it = blocked_peers.find(peer_actor);
       if (it != blocked_peers.end()) {
         BROKER_DEBUG("buffer batch from blocked peer" << hdl);
-        auto& bmsgs = blocked_msgs[peer_actor];
-        bmsgs.emplace_back(std::move(xs));
+        auto num_messages = xs.get_as<typename peer_trait::batch>(0).size();
+        if (auto err = blocked_buffer(peer_actor).push(xs, num_messages)) {
+          // Dropping the batch would leave a gap in the stream of the peer.
+          BROKER_ERROR("failed to buffer a batch from blocked peer" << hdl
+                                                                   << err);
+          remove_peer(peer_actor, std::move(err), false, false);
+          return;
+        }
+        update_blocked_stats();
         return;
       }
       auto num_workers = worker_manager().num_paths();
@@ -555,30 +622,53 @@ public:
                                                << BROKER_ARG(num_stores));
       // Only received from other peers. Extract content for to local workers
       // or stores and then forward to other peers.
+      auto& decoder = topic_decoders_[peer_actor];
       for (auto& msg : xs.get_mutable_as<typename peer_trait::batch>(0)) {
-        const topic* t;
-        // Dispatch to local workers or stores messages.
+        // Restore topics that the peer omitted on the wire.
+        if (!decoder.decode(msg)) {
+          // The dictionary of the sender no longer matches ours, i.e., we
+          // would fail to decode all further messages on this topic. Drop the
+          // peering instead. Peering again starts with empty dictionaries on
+          // both sides.
+          BROKER_ERROR("received a message with unknown topic ID from" << hdl);
+          remove_peer(peer_actor,
+                      make_error(ec::invalid_topic_key, "unknown topic ID"),
+                      false, false);
+          return;
+        }
+        // Drop copies that reached us on another path already. Cores in the
+        // same actor system share a node ID, so the epoch tells our own
+        // messages apart from messages of other local cores.
+        auto duplicate = [&] {
+          if (msg.origin == self()->node() && msg.epoch == epoch_)
+            return true;
+          return !dedup_.insert(origin_key{msg.origin, msg.epoch}, msg.seq);
+        };
+        if (msg.seq != 0 && duplicate()) {
+          BROKER_DEBUG("dropped a duplicate message from" << msg.origin);
+          if (stats_)
+            stats_->duplicates.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        // Check if forwarding is on and allowed for this message.
+        auto forward = d.options().forward && is_forwardable(msg);
+        // Dispatch to local workers or stores. The local managers share the
+        // content of `msg` with all of their paths, so we only need to copy
+        // the handle if we also forward the message.
         if (is_data_message(msg)) {
           auto& dm = get<data_message>(msg.content);
-          t = &get_topic(dm);
-          if (num_workers > 0)
+          if (num_workers > 0 && forward)
             worker_manager().push(dm);
+          else if (num_workers > 0)
+            worker_manager().push(std::move(dm));
         } else {
           auto& cm = get<command_message>(msg.content);
-          t = &get_topic(cm);
-          if (num_stores > 0)
+          if (num_stores > 0 && forward)
             store_manager().push(cm);
+          else if (num_stores > 0)
+            store_manager().push(std::move(cm));
         }
-        // Check if forwarding is on.
-        if (!dref().options().forward)
-          continue;
-        // Somewhat hacky, but don't forward data store clone messages.
-        auto ends_with = [](const std::string& s, const std::string& ending) {
-          if (ending.size() > s.size())
-            return false;
-          return std::equal(ending.rbegin(), ending.rend(), s.rbegin());
-        };
-        if (ends_with(t->string(), topics::clone_suffix.string()))
+        if (!forward)
           continue;
         // Either decrease TTL if message has one already, or add one.
         if (--msg.ttl == 0) {
@@ -651,6 +741,18 @@ public:
     return false;
   }
 
+  int32_t acquire_credit(caf::inbound_path* path, int32_t desired) override {
+    // Stop receiving from blocked peers once their buffer is full, unless we
+    // can write additional batches to disk.
+    auto i = istream_to_hdl_.find(path->slots.receiver);
+    if (i != istream_to_hdl_.end() && blocked_peers.count(i->second) != 0) {
+      auto j = blocked_msgs.find(i->second);
+      if (j != blocked_msgs.end() && j->second.full() && !j->second.spilling())
+        return 0;
+    }
+    return caf::stream_manager::acquire_credit(path, desired);
+  }
+
   bool done() const override {
     return !continuous() && pending_handshakes_ == 0 && inbound_paths_.empty()
            && out_.clean();
@@ -792,6 +894,66 @@ protected:
     return static_cast<ttl>(dref().options().ttl);
   }
 
+  /// Returns a random number for `epoch_`.
+  static uint64_t make_epoch() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+  }
+
+  /// Wraps `content` into a message that originates at this peer.
+  template <class T>
+  message_type
+  make_initial_message(T content,
+                       node_message_flags flags = node_message_flags::none) {
+    message_type result{std::move(content), initial_ttl(), flags};
+    result.origin = self()->node();
+    result.epoch = epoch_;
+    result.seq = ++seq_;
+    return result;
+  }
+
+  /// Returns the buffer for batches from the blocked peer `hdl`.
+  detail::blocked_peer_buffer& blocked_buffer(const caf::actor& hdl) {
+    if (auto i = blocked_msgs.find(hdl); i != blocked_msgs.end())
+      return i->second;
+    auto& opts = dref().options();
+    std::string spill_file;
+    if (!opts.blocked_peer_spill_directory.empty()) {
+      // Node IDs include host and process ID and the counter distinguishes
+      // multiple buffers for the same peer, so the name is unique even if
+      // several nodes share a spill directory.
+      static std::atomic<uint64_t> spill_file_counter;
+      spill_file = opts.blocked_peer_spill_directory;
+      spill_file += "/blocked-peer-";
+      spill_file += to_string(self()->node());
+      spill_file += '-';
+      spill_file += to_string(hdl.node());
+      spill_file += '-';
+      spill_file += std::to_string(++spill_file_counter);
+      spill_file += ".dat";
+    }
+    auto result = blocked_msgs.try_emplace(hdl, self()->system(),
+                                           opts.blocked_peer_max_bytes,
+                                           opts.blocked_peer_max_messages,
+                                           std::move(spill_file));
+    return result.first->second;
+  }
+
+  /// Publishes how many bytes we currently keep in memory and on disk for
+  /// blocked peers.
+  void update_blocked_stats() {
+    if (!stats_)
+      return;
+    size_t in_memory = 0;
+    size_t on_disk = 0;
+    for (auto& kvp : blocked_msgs) {
+      in_memory += kvp.second.buffered_bytes();
+      on_disk += kvp.second.spilled_bytes();
+    }
+    stats_->blocked_bytes.store(in_memory, std::memory_order_relaxed);
+    stats_->spilled_bytes.store(on_disk, std::memory_order_relaxed);
+  }
+
   /// Adds entries to `hdl_to_istream_` and `istream_to_hdl_`.
   void add_ipath(caf::stream_slot slot, const caf::actor& peer_hdl) {
     BROKER_TRACE(BROKER_ARG(slot) << BROKER_ARG(peer_hdl));
@@ -807,6 +969,8 @@ protected:
       BROKER_ERROR("peer_to_ipath entry already exists");
       return;
     }
+    // A new inbound path always starts with an empty topic dictionary.
+    topic_decoders_[peer_hdl] = detail::topic_decoder{};
   }
 
   /// Adds entries to `hdl_to_ostream_` and `ostream_to_peer_`.
@@ -880,8 +1044,38 @@ protected:
   /// Peers that are currently blocked (messages buffered until unblocked).
   std::unordered_set<caf::actor> blocked_peers;
 
-  /// Messages that are currently buffered.
-  std::unordered_map<caf::actor, std::vector<caf::message>> blocked_msgs;
+  /// Batches from blocked peers that are currently buffered.
+  std::unordered_map<caf::actor, detail::blocked_peer_buffer> blocked_msgs;
+
+  /// Restores topics on inbound paths from peers. The peer manager owns the
+  /// matching encoders for outbound paths.
+  std::unordered_map<caf::actor, detail::topic_decoder> topic_decoders_;
+
+  /// Identifies the core that published a message.
+  using origin_key = std::pair<PeerId, uint64_t>;
+
+  struct origin_key_hash {
+    size_t operator()(const origin_key& x) const noexcept {
+      return std::hash<PeerId>{}(x.first) ^ std::hash<uint64_t>{}(x.second);
+    }
+  };
+
+  /// Remembers recently received messages for dropping duplicates.
+  detail::dedup_window<origin_key, origin_key_hash> dedup_;
+
+  /// Counters for the endpoint. May be `nullptr` if no endpoint owns this peer.
+  detail::core_stats_ptr stats_;
+
+  /// Stores the sequence number of the last message that originated at this
+  /// peer.
+  uint64_t seq_ = 0;
+
+  /// Distinguishes messages of this peer from messages of other peers with
+  /// the same node ID.
+  uint64_t epoch_ = make_epoch();
+
+  /// Signals `remote_push` to leave emitting batches to `publish_all`.
+  bool bulk_publishing_ = false;
 
   /// Maps pending peer handles to output IDs. An invalid stream ID indicates
   /// that only "step #0" was performed so far. An invalid stream ID corresponds
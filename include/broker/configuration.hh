@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include <caf/actor_system_config.hpp>
 
 namespace broker {
@@ -11,12 +13,49 @@ struct broker_options {
   /// If true, endpoints will forward incoming messages to peers.
   bool forward = true;
 
+  /// If true, forwarding endpoints attach a list of receivers to each
+  /// message, so that each node delivers a message at most once even in
+  /// topologies with loops. Requires `forward`. Receiver lists grow with the
+  /// number of peers, so this option is off by default.
+  bool source_routing = false;
+
   /// TTL to insert into forwarded messages. Messages will be droppped once
   /// they have traversed more than this many hops. Note that the 1st
   /// receiver inserts the TTL (not the sender!). The 1st receiver does
   /// already count against the TTL.
   unsigned int ttl = 20;
 
+  /// Number of recently received messages per origin that a peer remembers in
+  /// order to drop duplicates, e.g., copies that arrive via loops in the
+  /// peering topology. Setting this to 0 disables duplicate suppression.
+  size_t dedup_window = 1024;
+
+  /// Maximum number of serialized bytes that a peer buffers for each blocked
+  /// peer. Once reaching this limit, the peer stops granting credit to the
+  /// blocked peer unless `blocked_peer_spill_directory` is set.
+  size_t blocked_peer_max_bytes = 16 * 1024 * 1024;
+
+  /// Maximum number of messages that a peer buffers for each blocked peer.
+  size_t blocked_peer_max_messages = 100000;
+
+  /// Directory for writing messages from blocked peers to disk after reaching
+  /// a buffer limit. Leaving this empty disables spilling to disk.
+  std::string blocked_peer_spill_directory;
+
+  /// Number of messages that a publisher buffers before `publish` blocks.
+  size_t publisher_queue_size = 30;
+
+  /// Upper bound for growing the buffer of a publisher while the core keeps
+  /// draining it completely. A value not greater than `publisher_queue_size`
+  /// disables growing.
+  size_t publisher_queue_max_size = 0;
+
+  /// Number of recent changes that each master keeps for clones that
+  /// reconnect after a short outage. Clones that missed more changes than
+  /// this receive a full snapshot instead. Setting this to 0 disables the
+  /// change log.
+  size_t store_change_log_size = 10000;
+
   /// Whether to use real/wall clock time for data store time-keeping
   /// tasks or whether the application will simulate time on its own.
   bool use_real_time = true;
@@ -11,5 +11,9 @@ extern const caf::string_view recording_directory;
 
 extern const size_t output_generator_file_cap;
 
+/// Number of entries that data stores read from their backend at once when
+/// iterating over all entries.
+extern const size_t store_scan_batch_size;
+
 } // namespace defaults
 } // namespace broker
@@ -2,10 +2,15 @@
 
 #include "broker/data.hh"
 #include "broker/expected.hh"
+#include "broker/internal_command.hh"
 #include "broker/optional.hh"
 #include "broker/snapshot.hh"
 
+#include <caf/span.hpp>
+
 #include <deque>
+#include <memory>
+#include <vector>
 
 namespace broker {
 namespace detail {
@@ -13,6 +18,36 @@ namespace detail {
 using expirable = std::pair<broker::data, timestamp>;
 using expirables = std::deque<expirable>;
 
+/// A key-value pair along with its expiration time.
+struct scan_entry {
+  data key;
+  data value;
+  optional<timestamp> expiry;
+};
+
+using scan_entries = std::vector<scan_entry>;
+
+/// Iterates over all entries of a backend in batches of bounded size. Callers
+/// may modify the backend between two calls to `next`. In this case, the scan
+/// still visits each key that exists for its entire duration, but may report
+/// either the old or the new value for keys that changed in the meantime.
+/// Scans may also report a key more than once if the backend grows during the
+/// scan.
+class backend_cursor {
+public:
+  virtual ~backend_cursor();
+
+  /// Replaces the content of `out` with the next entries of the scan.
+  /// @param out The buffer for the entries. Leaves `out` empty after reaching
+  ///            the end of the scan.
+  /// @param max_entries The maximum number of entries for `out`. Must be
+  ///                    greater than 0.
+  /// @returns `nil` on success.
+  virtual expected<void> next(scan_entries& out, size_t max_entries) = 0;
+};
+
+using backend_cursor_ptr = std::unique_ptr<backend_cursor>;
+
 /// Abstract base class for a key-value storage backend.
 class abstract_backend {
 public:
@@ -69,6 +104,34 @@ public:
   virtual expected<bool> expire(const data& key,
                                 timestamp current_time) = 0;
 
+  // --- batches --------------------------------------------------------------
+
+  /// Applies multiple commands in a single transaction. Calls `f` for each
+  /// command, whereas `f` modifies the backend via the regular member
+  /// functions. Within `f`, lookups already observe the changes of all
+  /// previous commands in `xs`. Other actors only observe the changes after
+  /// `apply_batch` returns. Calling `clear` during a batch is not allowed.
+  /// @param xs The commands for the transaction.
+  /// @param f Applies a single command to the backend.
+  /// @returns `nil` if the backend committed all changes.
+  template <class F>
+  expected<void> apply_batch(caf::span<internal_command> xs, F f) {
+    if (auto res = begin_batch(); !res)
+      return res;
+    for (auto& x : xs)
+      f(x);
+    return commit_batch();
+  }
+
+  /// Starts a new transaction for `apply_batch`. The default implementation
+  /// does nothing, i.e., modifications take effect immediately.
+  /// @returns `nil` on success.
+  virtual expected<void> begin_batch();
+
+  /// Commits all changes since the last call to `begin_batch`.
+  /// @returns `nil` if the backend committed all changes.
+  virtual expected<void> commit_batch();
+
   // --- inspectors -----------------------------------------------------------
 
   /// Retrieves the value associated with a given key.
@@ -94,11 +157,16 @@ public:
 
   /// Retrieves the current keys.
   /// @returns The set of current keys.
-  virtual expected<data> keys() const = 0;
+  virtual expected<data> keys() const;
 
   /// Retrieves all key-value pairs.
   /// @returns A snapshot of the store that includes its content.
-  virtual expected<broker::snapshot> snapshot() const = 0;
+  virtual expected<broker::snapshot> snapshot() const;
+
+  /// Starts iterating over all key-value pairs without loading the entire
+  /// store into memory.
+  /// @returns A cursor at the first entry of the store.
+  virtual backend_cursor_ptr scan() const = 0;
 
   /// @returns the set of all keys that have expiry times.
   virtual expected<expirables> expiries() const = 0;
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <caf/byte.hpp>
+#include <caf/fwd.hpp>
+#include <caf/message.hpp>
+
+namespace broker {
+namespace detail {
+
+/// Holds back batches from a peer while Broker blocks its traffic, e.g., until
+/// all status subscribers learned about a new peering. Keeps batches in memory
+/// as they arrived and accounts for them with their serialized size. After
+/// reaching one of its limits, the buffer either serializes additional batches
+/// to a spill file or relies on its owner to stop granting credit to the peer.
+class blocked_peer_buffer {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using byte_buffer = std::vector<caf::byte>;
+
+  using consumer = std::function<void(caf::message&)>;
+
+  /// Layout of spill files. Uses the same header as the generator files, but
+  /// with a different magic number. Each entry consists of a 32-bit size
+  /// followed by a serialized batch.
+  struct format {
+    static constexpr uint32_t magic = 0x2EECC0DF;
+
+    static constexpr uint8_t version = 1;
+
+    static constexpr size_t header_size = sizeof(magic) + sizeof(version);
+  };
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param sys Provides the context for (de)serializing actor handles, e.g.,
+  ///            in store commands.
+  /// @param max_bytes Maximum number of bytes in memory.
+  /// @param max_messages Maximum number of messages in memory.
+  /// @param spill_file Path for storing batches after reaching a limit or an
+  ///                   empty string to disable spilling.
+  blocked_peer_buffer(caf::actor_system& sys, size_t max_bytes,
+                      size_t max_messages, std::string spill_file = {});
+
+  blocked_peer_buffer(blocked_peer_buffer&&) = delete;
+
+  blocked_peer_buffer(const blocked_peer_buffer&) = delete;
+
+  blocked_peer_buffer& operator=(blocked_peer_buffer&&) = delete;
+
+  blocked_peer_buffer& operator=(const blocked_peer_buffer&) = delete;
+
+  ~blocked_peer_buffer();
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns whether the buffer reached one of its limits.
+  bool full() const noexcept {
+    return buffered_bytes_ >= max_bytes_ || buffered_messages_ >= max_messages_;
+  }
+
+  /// Returns whether the buffer writes batches to disk after reaching one of
+  /// its limits.
+  bool spilling() const noexcept {
+    return !spill_file_.empty();
+  }
+
+  /// Returns the number of bytes that the batches in memory would occupy in
+  /// serialized form.
+  size_t buffered_bytes() const noexcept {
+    return buffered_bytes_;
+  }
+
+  /// Returns the number of messages in memory.
+  size_t buffered_messages() const noexcept {
+    return buffered_messages_;
+  }
+
+  /// Returns the number of serialized bytes in the spill file.
+  size_t spilled_bytes() const noexcept {
+    return spilled_bytes_;
+  }
+
+  /// Returns the number of messages in the spill file.
+  size_t spilled_messages() const noexcept {
+    return spilled_messages_;
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds a batch with `num_messages` messages. Stores the batch in memory
+  /// unless the buffer is full and spilling is enabled.
+  caf::error push(caf::message batch, size_t num_messages);
+
+  /// Passes all batches in the order of arrival to `f` and clears the buffer.
+  caf::error drain(consumer f);
+
+private:
+  caf::error spill(const caf::message& batch, size_t& num_bytes);
+
+  void reset();
+
+  caf::actor_system& sys_;
+
+  size_t max_bytes_;
+
+  size_t max_messages_;
+
+  std::string spill_file_;
+
+  std::deque<caf::message> batches_;
+
+  /// Reusable buffer for serializing batches to the spill file.
+  byte_buffer spill_buf_;
+
+  size_t buffered_bytes_ = 0;
+
+  size_t buffered_messages_ = 0;
+
+  size_t spilled_bytes_ = 0;
+
+  size_t spilled_messages_ = 0;
+
+  std::ofstream out_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <caf/actor.hpp>
@@ -61,6 +63,23 @@ public:
 
   void operator()(clear_command&);
 
+  /// Prepares the clone for receiving a snapshot as a stream of entries.
+  void start_snapshot();
+
+  /// Inserts or updates a single entry of a streamed snapshot.
+  void apply_snapshot_entry(snapshot_entry& x);
+
+  /// Erases all keys that were missing in the streamed snapshot.
+  void finish_snapshot();
+
+  /// Applies the commands that the clone missed since its last sequence
+  /// number.
+  void apply_delta(snapshot_delta& x);
+
+  /// Replays buffered updates once the clone has received the snapshot as
+  /// well as the matching `snapshot_sync_command`.
+  void snapshot_complete();
+
   data keys() const;
 
   topic master_topic;
@@ -83,6 +102,23 @@ public:
 
   bool awaiting_snapshot_sync = true;
 
+  /// Keys that were present before receiving a streamed snapshot and that
+  /// the snapshot did not contain so far. Points to the keys in `store`
+  /// instead of copying them, since rehashing leaves pointers to the
+  /// elements of an `unordered_map` intact.
+  std::unordered_set<const data*> snapshot_stale_keys;
+
+  /// Sequence number of the last command from the master that is reflected in
+  /// `store`, or 0 if `store` does not match any sequence number.
+  uint64_t seq = 0;
+
+  /// Sequence number of the master at the sync point for the pending
+  /// snapshot.
+  uint64_t sync_seq = 0;
+
+  /// The master that assigned `seq`.
+  caf::actor_addr seq_source;
+
   static inline constexpr const char* name = "clone_actor";
 };
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <caf/allowed_unsafe_message_type.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/make_counted.hpp>
+#include <caf/ref_counted.hpp>
+
+#include "broker/fwd.hh"
+
+namespace broker::detail {
+
+/// Counters that the core updates while handling peer traffic. The endpoint
+/// reads them via `endpoint::peering_metrics` without sending messages to the
+/// core.
+class core_stats : public caf::ref_counted {
+public:
+  /// Number of peer messages that the core dropped as duplicates.
+  std::atomic<uint64_t> duplicates{0};
+
+  /// Number of bytes that the core buffers in memory for blocked peers.
+  std::atomic<uint64_t> blocked_bytes{0};
+
+  /// Number of bytes that the core buffers on disk for blocked peers.
+  std::atomic<uint64_t> spilled_bytes{0};
+};
+
+inline core_stats_ptr make_core_stats() {
+  return caf::make_counted<core_stats>();
+}
+
+} // namespace broker::detail
+
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::detail::core_stats_ptr)
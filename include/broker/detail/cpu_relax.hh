@@ -0,0 +1,18 @@
+#pragma once
+
+#include "broker/config.hh"
+
+#ifdef BROKER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace broker::detail {
+
+/// Tells the processor that the caller is in a busy-wait loop.
+inline void cpu_relax() {
+#ifdef BROKER_USE_SSE2
+  _mm_pause();
+#endif
+}
+
+} // namespace broker::detail
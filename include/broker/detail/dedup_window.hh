@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace broker {
+namespace detail {
+
+/// Remembers the most recent messages that a node received from its peers in
+/// order to drop copies that arrive via multiple paths or loops. Messages
+/// are identified by their origin and the sequence number that the origin
+/// assigned to them. The window keeps up to `capacity` entries per origin, so
+/// a busy origin cannot evict the entries of other origins. Once full, the
+/// window of an origin evicts its oldest entry. The window also keeps at most
+/// `max_origins` origins and drops all entries of the least recently active
+/// origin when adding a new one, so origins that left the network
+/// eventually disappear. Hence, memory usage is bounded by `capacity` times
+/// `max_origins`.
+template <class Origin, class Hash = std::hash<Origin>>
+class dedup_window {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  explicit dedup_window(size_t capacity = 0, size_t max_origins = 1024)
+    : capacity_(capacity), max_origins_(max_origins > 0 ? max_origins : 1) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the maximum number of entries per origin. A capacity of 0
+  /// disables duplicate suppression.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// Sets the maximum number of entries per origin, evicting the oldest
+  /// entries if necessary.
+  void capacity(size_t new_capacity) {
+    capacity_ = new_capacity;
+    if (capacity_ == 0) {
+      clear();
+      return;
+    }
+    for (auto& kvp : origins_)
+      shrink(kvp.second);
+  }
+
+  /// Returns the maximum number of origins.
+  size_t max_origins() const noexcept {
+    return max_origins_;
+  }
+
+  /// Sets the maximum number of origins, dropping the least recently active
+  /// origins if necessary.
+  void max_origins(size_t new_max) {
+    max_origins_ = new_max > 0 ? new_max : 1;
+    while (origins_.size() > max_origins_)
+      evict();
+  }
+
+  /// Returns the number of entries for all origins.
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// Returns the number of origins that the window keeps entries for.
+  size_t origins() const noexcept {
+    return origins_.size();
+  }
+
+  /// Returns how many duplicates this window detected so far.
+  uint64_t duplicates() const noexcept {
+    return duplicates_;
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds an entry for the message with sequence number `seq` from `origin`.
+  /// @returns `false` if the window already contains an entry for the
+  ///          message, `true` otherwise.
+  bool insert(const Origin& origin, uint64_t seq) {
+    if (capacity_ == 0)
+      return true;
+    auto i = origins_.find(origin);
+    if (i == origins_.end()) {
+      if (origins_.size() == max_origins_)
+        evict();
+      i = origins_.emplace(origin, entries_type{}).first;
+      i->second.pos = lru_.insert(lru_.end(), origin);
+    } else {
+      lru_.splice(lru_.end(), lru_, i->second.pos);
+    }
+    auto& entries = i->second;
+    if (!entries.seen.emplace(seq).second) {
+      ++duplicates_;
+      return false;
+    }
+    entries.order.emplace_back(seq);
+    ++size_;
+    shrink(entries);
+    return true;
+  }
+
+  /// Drops all entries.
+  void clear() {
+    origins_.clear();
+    lru_.clear();
+    size_ = 0;
+  }
+
+private:
+  struct entries_type {
+    /// Stores all entries for fast lookups.
+    std::unordered_set<uint64_t> seen;
+
+    /// Stores all entries in insertion order for evicting the oldest ones.
+    std::deque<uint64_t> order;
+
+    /// Points to the origin in `lru_`.
+    typename std::list<Origin>::iterator pos;
+  };
+
+  /// Drops the least recently active origin.
+  void evict() {
+    auto i = origins_.find(lru_.front());
+    size_ -= i->second.order.size();
+    origins_.erase(i);
+    lru_.pop_front();
+  }
+
+  void shrink(entries_type& entries) {
+    while (entries.order.size() > capacity_) {
+      entries.seen.erase(entries.order.front());
+      entries.order.pop_front();
+      --size_;
+    }
+  }
+
+  /// Maximum number of entries per origin.
+  size_t capacity_;
+
+  /// Maximum number of origins.
+  size_t max_origins_;
+
+  /// Number of entries for all origins.
+  size_t size_ = 0;
+
+  /// Number of detected duplicates.
+  uint64_t duplicates_ = 0;
+
+  /// Stores the entries for each origin.
+  std::unordered_map<Origin, entries_type, Hash> origins_;
+
+  /// Stores all origins, ordered from least to most recently active.
+  std::list<Origin> lru_;
+};
+
+} // namespace detail
+} // namespace broker
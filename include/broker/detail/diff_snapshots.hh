@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace broker {
+namespace detail {
+
+/// Compares two states of a key-value store with one hash lookup per key.
+/// Calls `on_erase(key)` for each key that exists only in `old_state`, then
+/// `on_update(key, old_value, new_value)` for each key that exists in both
+/// states, and finally `on_insert(key, value)` for each key that exists only
+/// in `new_state`.
+template <class Map, class OnErase, class OnUpdate, class OnInsert>
+void diff_snapshots(const Map& old_state, const Map& new_state,
+                    OnErase on_erase, OnUpdate on_update,
+                    OnInsert on_insert) {
+  using old_entry = typename Map::value_type;
+  using new_value = typename Map::mapped_type;
+  std::vector<std::pair<const old_entry*, const new_value*>> updated;
+  updated.reserve(std::min(old_state.size(), new_state.size()));
+  for (auto& kvp : old_state) {
+    if (auto i = new_state.find(kvp.first); i != new_state.end())
+      updated.emplace_back(&kvp, &i->second);
+    else
+      on_erase(kvp.first);
+  }
+  for (auto& [entry, value] : updated)
+    on_update(entry->first, entry->second, *value);
+  // Each key in `new_state` that also exists in `old_state` appeared in the
+  // first loop. Hence, all remaining keys are new.
+  if (updated.size() == new_state.size())
+    return;
+  for (auto& kvp : new_state)
+    if (old_state.count(kvp.first) == 0)
+      on_insert(kvp.first, kvp.second);
+}
+
+} // namespace detail
+} // namespace broker
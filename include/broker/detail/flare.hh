@@ -1,8 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <chrono>
 
+#include "broker/config.hh"
 #include "broker/time.hh"
 
 #include <caf/io/network/native_socket.hpp>
@@ -14,16 +16,22 @@ namespace broker::detail {
 /// signal availability of a resource across threads, both access to that
 /// resource and the use of the fire/extinguish functions must be performed in
 /// a thread-safe manner in order for that to work correctly.
+///
+/// On Linux, the flare uses an `eventfd` in semaphore mode instead of a pipe
+/// and keeps the number of pending signals in an atomic counter. Only the
+/// first `fire` on an inactive flare and the last extinguish of an active
+/// flare touch the file descriptor, i.e., firing an active flare never causes
+/// a system call.
 class flare {
 public:
   using timeout_type = clock::time_point;
 
   using native_socket = caf::io::network::native_socket;
 
-  /// Constructs a flare by opening a UNIX pipe.
+  /// Constructs a flare by opening a UNIX pipe or an `eventfd`.
   flare();
 
-  /// Destructs the flare, closing the UNIX pipe's file descriptors.
+  /// Destructs the flare, closing its file descriptors.
   ~flare();
 
   flare(const flare&) = delete;
@@ -73,6 +81,12 @@ private:
   bool await_one_impl(int ms_timeout);
 
   native_socket fds_[2];
+
+#ifdef BROKER_LINUX
+  /// Number of fired but not yet extinguished signals. The `eventfd` is
+  /// readable while this counter is greater than zero.
+  std::atomic<size_t> pending_;
+#endif
 };
 
 } // namespace broker::detail
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <caf/broadcast_downstream_manager.hpp>
+#include <caf/fwd.hpp>
+#include <caf/outbound_path.hpp>
+#include <caf/stream_slot.hpp>
+
+#include "broker/detail/topic_index.hh"
+#include "broker/message.hh"
+
+namespace broker {
+namespace detail {
+
+/// A broadcast downstream manager that dispatches buffered elements through a
+/// ::topic_index instead of evaluating the selector once per path and element.
+/// The selector provides the topics of a filter via `topics(filter)` and may
+/// still exclude individual paths via `accepts(filter)`, e.g., to skip the
+/// sender of a batch. Any change to the paths or filters invalidates the index
+/// and its cached routing decisions.
+/// @note Each path buffers its own handle to an element. With `n` receiving
+///       paths, an element costs `n - 1` reference count updates, because the
+///       last receiver gets the moved element. Paths do not share batches.
+template <class T, class Filter, class Select>
+class indexed_downstream_manager
+  : public caf::broadcast_downstream_manager<T, Filter, Select> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using super = caf::broadcast_downstream_manager<T, Filter, Select>;
+
+  using filter_type = Filter;
+
+  using unique_path_ptr = typename super::unique_path_ptr;
+
+  using iterator = typename std::vector<T>::iterator;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  explicit indexed_downstream_manager(caf::stream_manager* parent)
+    : super(parent) {
+    // nop
+  }
+
+  // -- filter management ------------------------------------------------------
+
+  // Note: the base type does not declare the following member functions as
+  //       virtual. Hence, callers must access them through this type.
+
+  void set_filter(caf::stream_slot slot, filter_type new_filter) {
+    super::set_filter(slot, std::move(new_filter));
+    dirty_ = true;
+  }
+
+  /// Grants mutable access to the filter of `slot`, invalidating the index.
+  filter_type& filter(caf::stream_slot slot) {
+    dirty_ = true;
+    return super::filter(slot);
+  }
+
+  // -- overridden member functions of caf::downstream_manager -----------------
+
+  bool insert_path(unique_path_ptr ptr) override {
+    dirty_ = true;
+    return super::insert_path(std::move(ptr));
+  }
+
+  void emit_batches() override {
+    fan_out_flush();
+    super::emit_batches();
+  }
+
+  void force_emit_batches() override {
+    fan_out_flush();
+    super::force_emit_batches();
+  }
+
+  // -- dispatching ------------------------------------------------------------
+
+  /// Moves all elements from the central buffer to the buffers of all
+  /// matching paths. Looks up the matching paths only once for each run of
+  /// consecutive elements with the same topic.
+  void fan_out_flush() {
+    auto& buf = this->buf_;
+    if (buf.empty())
+      return;
+    if (dirty_)
+      rebuild_index();
+    auto first = buf.begin();
+    while (first != buf.end()) {
+      auto& t = get_topic(*first);
+      auto last = std::find_if(first + 1, buf.end(), [&t](const T& x) {
+        return get_topic(x) != t;
+      });
+      fan_out(first, last, index_.matches(t));
+      first = last;
+    }
+    buf.clear();
+  }
+
+protected:
+  /// Appends the elements in `[first, last)`, which all share the same topic,
+  /// to the buffers of all paths at `positions` unless the path is closing or
+  /// the selector rejects it. Subtypes can override this function to make
+  /// routing decisions per element.
+  /// @note The central buffer drops all elements afterwards. Hence,
+  ///       implementations may move them into the buffer of the last receiver.
+  virtual void fan_out(iterator first, iterator last,
+                       const topic_index::id_list& positions) {
+    auto& states = this->states().container();
+    auto append_all = [&](size_t pos, auto fn) {
+      // Note: no reserve() here. Reserving the exact size of each run defeats
+      // the geometric growth of the buffer and reallocates once per run.
+      auto& [slot, st] = states[pos];
+      for (auto i = first; i != last; ++i)
+        append(slot, st.buf, fn(*i));
+    };
+    auto copy = [](T& x) -> const T& { return x; };
+    auto move = [](T& x) -> T&& { return std::move(x); };
+    auto receiver = positions.end();
+    for (auto i = positions.begin(); i != positions.end(); ++i) {
+      if (!is_receiver(*i))
+        continue;
+      if (receiver != positions.end())
+        append_all(*receiver, copy);
+      receiver = i;
+    }
+    if (receiver != positions.end())
+      append_all(*receiver, move);
+  }
+
+  /// Returns whether the path at `pos` may receive the element that we are
+  /// currently dispatching.
+  bool is_receiver(size_t pos) {
+    // Don't push new data into a closing path.
+    if (this->paths_.container()[pos].second->closing)
+      return false;
+    auto& st = this->states().container()[pos].second;
+    return this->selector().accepts(st.filter);
+  }
+
+  /// Appends `x` to `buf`, the buffer of the path at `slot`. Subtypes can
+  /// override this function to adjust elements per path.
+  virtual void append([[maybe_unused]] caf::stream_slot slot,
+                      std::vector<T>& buf, T x) {
+    buf.emplace_back(std::move(x));
+  }
+
+  void about_to_erase(caf::outbound_path* ptr, bool silent,
+                      caf::error* reason) override {
+    dirty_ = true;
+    super::about_to_erase(ptr, silent, reason);
+  }
+
+private:
+  /// Re-creates the index from the current filters. The base type keeps its
+  /// paths and states equally sorted, so we can use the position in the state
+  /// container as ID for both.
+  void rebuild_index() {
+    index_.clear();
+    auto& sel = this->selector();
+    auto& states = this->states().container();
+    for (size_t pos = 0; pos < states.size(); ++pos)
+      index_.add(pos, sel.topics(states[pos].second.filter));
+    dirty_ = false;
+  }
+
+  /// Maps subscriptions to positions in the path and state containers.
+  topic_index index_;
+
+  /// Signals that paths or filters changed since the last rebuild.
+  bool dirty_ = true;
+};
+
+} // namespace detail
+} // namespace broker
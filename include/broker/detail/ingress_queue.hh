@@ -0,0 +1,29 @@
+#pragma once
+
+#include <caf/allowed_unsafe_message_type.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/make_counted.hpp>
+#include <caf/ref_counted.hpp>
+
+#include "broker/detail/mpsc_queue.hh"
+#include "broker/fwd.hh"
+#include "broker/message.hh"
+
+namespace broker::detail {
+
+/// Collects messages from threads that publish via the `endpoint` until the
+/// core drains them. Only the thread that adds the first message to an empty
+/// queue notifies the core, so the core receives one message per drained
+/// sequence instead of one message per published item.
+class ingress_queue : public caf::ref_counted {
+public:
+  mpsc_queue<data_message> xs;
+};
+
+inline ingress_queue_ptr make_ingress_queue() {
+  return caf::make_counted<ingress_queue>();
+}
+
+} // namespace broker::detail
+
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::detail::ingress_queue_ptr)
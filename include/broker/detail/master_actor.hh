@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
+#include <caf/span.hpp>
 #include <caf/stateful_actor.hpp>
 #include <caf/event_based_actor.hpp>
 
@@ -12,6 +17,7 @@
 #include "broker/endpoint.hh"
 #include "broker/fwd.hh"
 #include "broker/internal_command.hh"
+#include "broker/optional.hh"
 #include "broker/publisher_id.hh"
 #include "broker/topic.hh"
 
@@ -29,17 +35,27 @@ public:
 
   /// Initializes the object.
   void init(caf::event_based_actor* ptr, std::string&& nm,
-            backend_pointer&& bp, caf::actor&& parent, endpoint::clock* clock);
+            backend_pointer&& bp, caf::actor&& parent, endpoint::clock* clock,
+            size_t change_log_capacity);
 
   /// Sends `x` to all clones.
   void broadcast(internal_command&& x);
 
+  /// Assigns the next sequence number to `x`, adds it to the change log and
+  /// sends it to all clones.
+  void broadcast_change(internal_command&& x);
+
   template <class T>
   void broadcast_cmd_to_clones(T cmd) {
-    if (!clones.empty())
-      broadcast(internal_command{std::move(cmd)});
+    broadcast_change(internal_command{std::move(cmd)});
   }
 
+  /// Returns all commands after `last_seq` if the change log still contains
+  /// them.
+  optional<std::vector<internal_command>> changes_since(uint64_t last_seq);
+
+  /// Schedules an `expire` message for `key`. While `defer_output` is
+  /// `true`, stores the timer in `deferred_reminders` instead.
   void remind(timespan expiry, const data& key);
 
   void expire(data& key);
@@ -48,6 +64,16 @@ public:
 
   void command(internal_command::variant_type& cmd);
 
+  /// Processes a batch of commands from the input stream. Applies each run of
+  /// consecutive updates via `apply_batch`.
+  void command(caf::span<internal_command> cmds);
+
+  /// Applies all commands in a single transaction of the backend. Holds back
+  /// all events, updates for clones, responses and expiry timers until the
+  /// backend committed the batch. If the commit fails, the master drops
+  /// these and replies `false` to each `put_unique_command`.
+  void apply_batch(caf::span<internal_command> cmds);
+
   void operator()(none);
 
   void operator()(put_command&);
@@ -76,6 +102,19 @@ public:
 
   std::unordered_map<caf::actor_addr, caf::actor> clones;
 
+  /// Sequence number of the most recent command for the clones.
+  uint64_t seq = 0;
+
+  /// Stores the most recent commands for the clones. Allows clones that lost
+  /// their connection for a short time to catch up without a full snapshot.
+  std::deque<internal_command> change_log;
+
+  /// Maximum number of commands in `change_log`.
+  size_t change_log_size = 0;
+
+  /// Timers for `remind` that wait for the current batch to commit.
+  std::vector<std::pair<timespan, data>> deferred_reminders;
+
   bool exists(const data& key);
 
   static inline constexpr const char* name = "master_actor";
@@ -84,7 +123,7 @@ public:
 caf::behavior master_actor(caf::stateful_actor<master_state>* self,
                            caf::actor core, std::string id,
                            master_state::backend_pointer backend,
-                           endpoint::clock* clock);
+                           endpoint::clock* clock, size_t change_log_size);
 
 } // namespace detail
 } // namespace broker
@@ -12,6 +12,9 @@ namespace detail {
 /// An in-memory key-value storage backend.
 class memory_backend : public abstract_backend {
 public:
+  using store_type
+    = std::unordered_map<data, std::pair<data, optional<timestamp>>>;
+
   /// Constructs a memory backend.
   /// @param opts The options controlling the backend behavior.
   memory_backend(backend_options opts = backend_options{});
@@ -39,15 +42,13 @@ public:
 
   expected<uint64_t> size() const override;
 
-  expected<data> keys() const override;
-
-  expected<broker::snapshot> snapshot() const override;
+  backend_cursor_ptr scan() const override;
 
   expected<expirables> expiries() const override;
 
 private:
   backend_options options_;
-  std::unordered_map<data, std::pair<data, optional<timestamp>>> store_;
+  store_type store_;
   std::unordered_map<data, timestamp> expirations_;
 };
 
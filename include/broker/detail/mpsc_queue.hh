@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace broker {
+namespace detail {
+
+/// A lock-free, unbounded queue for any number of producer threads and
+/// exactly one consumer thread. Producers push onto an atomic stack and the
+/// consumer takes the entire stack at once, restoring the insertion order
+/// before processing it. Hence, the consumer pays for synchronization once per
+/// drained sequence rather than once per element.
+template <class T>
+class mpsc_queue {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using value_type = T;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  mpsc_queue() = default;
+
+  mpsc_queue(const mpsc_queue&) = delete;
+
+  mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+  ~mpsc_queue() {
+    release(head_.load());
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns whether the queue is empty. Any thread may call this function.
+  bool empty() const noexcept {
+    return head_.load(std::memory_order_acquire) == nullptr;
+  }
+
+  // -- producer interface -----------------------------------------------------
+
+  /// Appends `x` to the queue.
+  /// @returns `true` if the queue was empty, i.e., the caller must wake up the
+  ///          consumer, `false` otherwise.
+  bool push(T x) {
+    auto ptr = new node{std::move(x), nullptr};
+    return link(ptr, ptr);
+  }
+
+  /// Appends all elements in `[first, last)` to the queue at once.
+  /// @returns `true` if the queue was empty, i.e., the caller must wake up the
+  ///          consumer, `false` otherwise.
+  template <class Iterator>
+  bool push(Iterator first, Iterator last) {
+    if (first == last)
+      return false;
+    // Build the chain in reverse order, since the stack stores the most recent
+    // element first.
+    auto tail = new node{*first, nullptr};
+    auto top = tail;
+    for (++first; first != last; ++first)
+      top = new node{*first, top};
+    return link(top, tail);
+  }
+
+  // -- consumer interface -----------------------------------------------------
+
+  /// Removes all elements from the queue and passes them to `f` in the order
+  /// of insertion.
+  /// @returns The number of removed elements.
+  template <class F>
+  size_t drain(F f) {
+    auto ptr = head_.exchange(nullptr, std::memory_order_acquire);
+    // Reverse the stack.
+    node* fifo = nullptr;
+    while (ptr != nullptr) {
+      auto next = ptr->next;
+      ptr->next = fifo;
+      fifo = ptr;
+      ptr = next;
+    }
+    size_t result = 0;
+    while (fifo != nullptr) {
+      auto next = fifo->next;
+      f(std::move(fifo->value));
+      delete fifo;
+      fifo = next;
+      ++result;
+    }
+    return result;
+  }
+
+private:
+  struct node {
+    T value;
+    node* next;
+  };
+
+  bool link(node* top, node* tail) {
+    auto old = head_.load(std::memory_order_relaxed);
+    do {
+      tail->next = old;
+    } while (!head_.compare_exchange_weak(old, top, std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return old == nullptr;
+  }
+
+  static void release(node* ptr) {
+    while (ptr != nullptr) {
+      auto next = ptr->next;
+      delete ptr;
+      ptr = next;
+    }
+  }
+
+  /// Points to the most recently added element.
+  std::atomic<node*> head_{nullptr};
+};
+
+} // namespace detail
+} // namespace broker
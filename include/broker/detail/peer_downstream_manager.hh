@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <caf/fwd.hpp>
+#include <caf/outbound_path.hpp>
+#include <caf/stream_slot.hpp>
+
+#include "broker/detail/indexed_downstream_manager.hh"
+#include "broker/detail/topic_dictionary.hh"
+#include "broker/logger.hh"
+#include "broker/message.hh"
+#include "broker/peer_filter.hh"
+
+namespace broker {
+namespace detail {
+
+/// Dispatches messages to peers and compresses their topics with one
+/// ::topic_encoder per outbound path.
+///
+/// With source routing enabled, the manager uses the `receivers` of each
+/// message as the set of nodes that already got a copy. The first hop puts
+/// itself and all peers with a matching filter into this set. Each further hop
+/// only sends copies to matching peers that are not yet in the set and adds
+/// these peers before forwarding. Hence, a node never forwards a message to
+/// peers that receive it from an earlier hop, e.g., in a triangle.
+template <class PeerId>
+class peer_downstream_manager
+  : public indexed_downstream_manager<generic_node_message<PeerId>,
+                                      peer_filter, peer_filter_matcher> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using element_type = generic_node_message<PeerId>;
+
+  using super = indexed_downstream_manager<element_type, peer_filter,
+                                           peer_filter_matcher>;
+
+  using unique_path_ptr = typename super::unique_path_ptr;
+
+  using iterator = typename super::iterator;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  explicit peer_downstream_manager(caf::stream_manager* parent)
+    : super(parent) {
+    // nop
+  }
+
+  // -- overridden member functions of caf::downstream_manager -----------------
+
+  bool insert_path(unique_path_ptr ptr) override {
+    auto slot = ptr->slots.sender;
+    if (!super::insert_path(std::move(ptr)))
+      return false;
+    // A new path always starts with an empty dictionary.
+    encoders_[slot] = topic_encoder{};
+    return true;
+  }
+
+  // -- source routing ---------------------------------------------------------
+
+  /// Enables receiver lists on all messages that pass through this manager.
+  /// @param own_id ID of the local node.
+  void enable_source_routing(PeerId own_id) {
+    own_id_ = std::move(own_id);
+    source_routing_ = true;
+  }
+
+  /// Returns whether this manager adds receiver lists to messages.
+  bool source_routing() const noexcept {
+    return source_routing_;
+  }
+
+protected:
+  void fan_out(iterator first, iterator last,
+               const topic_index::id_list& positions) override {
+    if (!source_routing_) {
+      super::fan_out(first, last, positions);
+      return;
+    }
+    // Each message carries its own receiver list.
+    for (auto i = first; i != last; ++i)
+      route(*i, positions);
+  }
+
+  void append(caf::stream_slot slot, std::vector<element_type>& buf,
+              element_type x) override {
+    buf.emplace_back(std::move(x));
+    encoders_[slot].encode(buf.back());
+  }
+
+  void about_to_erase(caf::outbound_path* ptr, bool silent,
+                      caf::error* reason) override {
+    encoders_.erase(ptr->slots.sender);
+    super::about_to_erase(ptr, silent, reason);
+  }
+
+private:
+  /// Sends `x` to all paths at `positions` that do not appear in its
+  /// receiver list yet.
+  void route(element_type& x, const topic_index::id_list& positions) {
+    auto& states = this->states().container();
+    auto& rs = x.receivers;
+    auto covered = [&rs](const PeerId& id) {
+      return std::find(rs.begin(), rs.end(), id) != rs.end();
+    };
+    targets_.clear();
+    for (auto pos : positions) {
+      if (!this->is_receiver(pos))
+        continue;
+      auto id = states[pos].second.filter.first.node();
+      if (!covered(id))
+        targets_.emplace_back(pos, std::move(id));
+    }
+    if (targets_.empty())
+      return;
+    if (unique_ids()) {
+      if (rs.empty())
+        rs.emplace_back(own_id_);
+      for (auto& target : targets_)
+        rs.emplace_back(target.second);
+    } else {
+      // Actors in the same process share a node ID, which renders receiver
+      // lists meaningless. Fall back to flooding in this case.
+      BROKER_DEBUG("disable source routing for message with ambiguous IDs");
+    }
+    for (size_t i = 0; i + 1 < targets_.size(); ++i) {
+      auto pos = targets_[i].first;
+      append(states[pos].first, states[pos].second.buf, x);
+    }
+    auto pos = targets_.back().first;
+    append(states[pos].first, states[pos].second.buf, std::move(x));
+  }
+
+  /// Checks whether the IDs in `targets_` and our own ID are all distinct.
+  bool unique_ids() const {
+    for (auto i = targets_.begin(); i != targets_.end(); ++i) {
+      auto& id = i->second;
+      auto same_id = [&id](const auto& y) { return y.second == id; };
+      if (id == own_id_ || std::any_of(i + 1, targets_.end(), same_id))
+        return false;
+    }
+    return true;
+  }
+
+  /// Compresses topics per outbound path.
+  std::unordered_map<caf::stream_slot, topic_encoder> encoders_;
+
+  /// Adds receiver lists to messages if `true`.
+  bool source_routing_ = false;
+
+  /// ID of the local node.
+  PeerId own_id_;
+
+  /// Positions and IDs of peers that receive the currently dispatched message.
+  /// Member variable to avoid allocating a vector for each message.
+  std::vector<std::pair<size_t, PeerId>> targets_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -20,6 +20,16 @@ struct prefix_matcher {
   bool operator()(const filter_type& filter, const T& x) const {
     return (*this)(filter, get_topic(x));
   }
+
+  /// Returns the subscriptions in `filter`.
+  const filter_type& topics(const filter_type& filter) const noexcept {
+    return filter;
+  }
+
+  /// Returns whether a path with `filter` may receive any message at all.
+  bool accepts(const filter_type&) const noexcept {
+    return true;
+  }
 };
 
 
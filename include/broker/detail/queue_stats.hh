@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "broker/queue_metrics.hh"
+#include "broker/time.hh"
+
+namespace broker {
+namespace detail {
+
+/// A lock-free histogram for latencies in nanoseconds. Splits each power of
+/// two into eight buckets, i.e., the bucket of a value overestimates the value
+/// by at most 12.5%. Recording is wait-free and any thread may read the
+/// histogram at any time.
+class latency_histogram {
+public:
+  // -- constants --------------------------------------------------------------
+
+  /// Number of bits for selecting the bucket within a power of two.
+  static constexpr size_t sub_bucket_bits = 3;
+
+  static constexpr size_t sub_buckets = size_t{1} << sub_bucket_bits;
+
+  static constexpr size_t num_buckets = (64 - sub_bucket_bits + 1)
+                                        * sub_buckets;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the total number of recorded values.
+  uint64_t count() const noexcept;
+
+  /// Returns the largest recorded value.
+  uint64_t max() const noexcept {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  /// Returns an upper bound for the value at percentile `p` (between 0 and
+  /// 1), i.e., at least a fraction of `p` of all recorded values are less
+  /// than or equal to the result.
+  uint64_t percentile(double p) const noexcept;
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Records `n` occurrences of `value`.
+  void record(uint64_t value, uint64_t n = 1) noexcept;
+
+  // -- bucket mapping ---------------------------------------------------------
+
+  /// Returns the index of the bucket for `value`.
+  static size_t bucket_of(uint64_t value) noexcept;
+
+  /// Returns the largest value that falls into the bucket at `index`.
+  static uint64_t upper_bound_of(size_t index) noexcept;
+
+private:
+  std::array<std::atomic<uint64_t>, num_buckets> buckets_{};
+
+  std::atomic<uint64_t> max_{0};
+};
+
+/// Computes a rate from a monotonic counter without requiring a timer. Each
+/// call to `update` that happens at least one second after the previous
+/// sample computes the average rate since that sample.
+class rate_meter {
+public:
+  rate_meter();
+
+  /// Returns the most recent rate per second of `counter`.
+  size_t update(uint64_t counter) noexcept;
+
+private:
+  std::atomic<int64_t> last_time_;
+  std::atomic<uint64_t> last_count_{0};
+  std::atomic<size_t> rate_{0};
+};
+
+/// Counts items flowing through a queue and measures how long items stay in
+/// the queue. All member functions are lock-free.
+class queue_stats {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using clock_type = std::chrono::steady_clock;
+
+  // -- properties -------------------------------------------------------------
+
+  uint64_t enqueued() const noexcept {
+    return enqueued_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t dequeued() const noexcept {
+    return dequeued_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  const latency_histogram& latency() const noexcept {
+    return latency_;
+  }
+
+  /// Returns the number of items per second entering the queue.
+  size_t enqueue_rate() const noexcept {
+    return enqueue_rate_.update(enqueued());
+  }
+
+  /// Returns the number of items per second leaving the queue.
+  size_t dequeue_rate() const noexcept {
+    return dequeue_rate_.update(dequeued());
+  }
+
+  /// Returns a snapshot of all counters.
+  queue_metrics metrics(std::string name) const;
+
+  // -- modifiers --------------------------------------------------------------
+
+  void on_enqueue(size_t n) noexcept {
+    enqueued_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// Records `n` items leaving the queue after spending `latency` in it.
+  void on_dequeue(size_t n, clock_type::duration latency) noexcept {
+    dequeued_.fetch_add(n, std::memory_order_relaxed);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency);
+    latency_.record(static_cast<uint64_t>(std::max(ns.count(), int64_t{0})),
+                    n);
+  }
+
+  /// Records `n` items that the queue discarded instead of passing them to
+  /// the consumer, including items that it removed after enqueueing them.
+  void on_drop(size_t n) noexcept {
+    dropped_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> enqueued_{0};
+  std::atomic<uint64_t> dequeued_{0};
+  std::atomic<uint64_t> dropped_{0};
+  latency_histogram latency_;
+  mutable rate_meter enqueue_rate_;
+  mutable rate_meter dequeue_rate_;
+};
+
+/// Marks a run of `count` consecutive items that entered a queue at `time`.
+struct enqueue_mark {
+  size_t count;
+  queue_stats::clock_type::time_point time;
+};
+
+} // namespace detail
+} // namespace broker
@@ -44,15 +44,17 @@ public:
 
   expected<bool> expire(const data& key, timestamp current_time) override;
 
+  expected<void> begin_batch() override;
+
+  expected<void> commit_batch() override;
+
   expected<data> get(const data& key) const override;
 
   expected<bool> exists(const data& key) const override;
 
   expected<uint64_t> size() const override;
 
-  expected<data> keys() const override;
-
-  expected<broker::snapshot> snapshot() const override;
+  backend_cursor_ptr scan() const override;
 
   expected<expirables> expiries() const override;
 
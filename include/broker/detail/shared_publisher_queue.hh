@@ -21,6 +21,11 @@ namespace detail {
 /// - consume() fires the flare when it removes items from xs_ and less than 20
 ///   items remain
 /// - produce() extinguishes the flare it adds items to xs_, exceeding 20
+///
+/// With a `max_capacity` above the initial capacity, the queue doubles its
+/// capacity (up to `max_capacity`) whenever the worker finds it full and
+/// drains it completely, i.e., when the downstream demand exceeds what the
+/// queue can hold.
 template <class ValueType = data_message>
 class shared_publisher_queue : public shared_queue<ValueType> {
 public:
@@ -30,11 +35,23 @@ public:
 
   using guard_type = typename super::guard_type;
 
-  shared_publisher_queue(size_t buffer_size) : capacity_(buffer_size) {
+  explicit shared_publisher_queue(size_t buffer_size, size_t max_capacity = 0)
+    : capacity_(buffer_size), max_capacity_(max_capacity) {
     // The flare is active as long as publishers can write.
     this->fx_.fire();
   }
 
+  queue_metrics metrics(std::string name) const override {
+    auto result = this->stats_.metrics(std::move(name));
+    result.buffered = buffer_size();
+    return result;
+  }
+
+  // Returns the number of buffered items without locking the mutex.
+  size_t buffer_size() const {
+    return size_.load();
+  }
+
   // Called to pull items out of the queue. Signals demand to the user if less
   // than `num` items can be published from the buffer. When calling consume
   // again after an unsuccessful run, `num` must not be smaller than on the
@@ -55,12 +72,18 @@ public:
       fun(std::move(*i));
     auto old_size = xs.size();
     xs.erase(b, e);
+    this->on_dequeue(n);
     auto new_size = xs.size();
+    size_ = new_size;
+    auto was_full = old_size >= capacity_;
+    // Grow the buffer if the downstream demand exceeds what we can hold.
+    if (was_full && new_size == 0 && capacity_ < max_capacity_)
+      capacity_ = std::min(capacity_ * 2, max_capacity_);
     // Extinguish the flare if we reach the capacity or fire it if we drop
     // below the capacity again.
-    if (new_size >= capacity_ && old_size < capacity_)
+    if (new_size >= capacity_ && !was_full)
       this->fx_.extinguish();
-    else if (new_size < capacity_ && old_size >= capacity_)
+    else if (new_size < capacity_ && was_full)
       this->fx_.fire();
     if (num - n > 0)
       this->pending_ = static_cast<long>(num - n);
@@ -79,6 +102,8 @@ public:
     BROKER_ASSERT(xs_old_size < capacity_);
     for (; first != last; ++first)
       xs.emplace_back(t, std::move(*first));
+    this->on_enqueue(xs.size() - xs_old_size);
+    size_ = xs.size();
     if (xs.size() >= capacity_) {
       // Extinguish the flare to cause the *next* produce to block.
       this->fx_.extinguish();
@@ -95,6 +120,8 @@ public:
     auto xs_old_size = xs.size();
     BROKER_ASSERT(xs_old_size < capacity_);
     xs.emplace_back(t, std::move(y));
+    this->on_enqueue(1);
+    size_ = xs.size();
     if (xs.size() >= capacity_) {
       // Extinguish the flare to cause the *next* produce to block.
       this->fx_.extinguish();
@@ -106,6 +133,10 @@ public:
     return capacity_;
   }
 
+  size_t max_capacity() const {
+    return max_capacity_;
+  }
+
 private:
   void await_consumer(guard_type& guard) {
     // Block the caller until the consumer catched up.
@@ -120,8 +151,15 @@ private:
   }
 
 
-  // Configures the amound of items for xs_.
-  const size_t capacity_;
+  // Configures the amound of items for xs_. Only grows if max_capacity_ is
+  // greater than the initial capacity.
+  std::atomic<size_t> capacity_;
+
+  // Configures the upper bound for capacity_.
+  const size_t max_capacity_;
+
+  /// Mirrors `xs_.size()` for reading the size without locking the mutex.
+  std::atomic<size_t> size_{0};
 };
 
 template <class ValueType = data_message>
@@ -130,8 +168,9 @@ using shared_publisher_queue_ptr
 
 template <class ValueType = data_message>
 shared_publisher_queue_ptr<ValueType>
-make_shared_publisher_queue(size_t buffer_size) {
-  return caf::make_counted<shared_publisher_queue<ValueType>>(buffer_size);
+make_shared_publisher_queue(size_t buffer_size, size_t max_capacity = 0) {
+  return caf::make_counted<shared_publisher_queue<ValueType>>(buffer_size,
+                                                              max_capacity);
 }
 
 } // namespace detail
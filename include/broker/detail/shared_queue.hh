@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
+#include <string>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 
+#include <caf/intrusive_ptr.hpp>
 #include <caf/ref_counted.hpp>
 
 #include "broker/data.hh"
@@ -13,6 +16,7 @@
 #include "broker/topic.hh"
 
 #include "broker/detail/flare.hh"
+#include "broker/detail/queue_stats.hh"
 
 namespace broker {
 namespace detail {
@@ -35,8 +39,15 @@ public:
     return pending_.load();
   }
 
-  size_t rate() const {
-    return rate_.load();
+  const queue_stats& stats() const noexcept {
+    return stats_;
+  }
+
+  /// Returns a snapshot of the counters for this queue.
+  virtual queue_metrics metrics(std::string name) const {
+    auto result = stats_.metrics(std::move(name));
+    result.buffered = buffer_size();
+    return result;
   }
 
   size_t buffer_size() const {
@@ -50,10 +61,6 @@ public:
     pending_ = x;
   }
 
-  void rate(size_t x) {
-    rate_ = x;
-  }
-
   void wait_on_flare() {
     fx_.await_one();
   }
@@ -74,11 +81,57 @@ public:
     return fx_.await_one(abs_timeout);
   }
 
+  // --- coalescing of wakeup messages -----------------------------------------
+
+  /// Marks a resume message to the worker as in flight.
+  /// @returns `true` if the caller must send the resume message, `false` if
+  ///          the worker has yet to process a previous one.
+  bool request_resume() {
+    return !resume_pending_.exchange(true);
+  }
+
+  /// Allows callers of `request_resume` to send the next resume message. The
+  /// worker calls this function when receiving a resume message, i.e., before
+  /// accessing the buffer.
+  void clear_resume() {
+    resume_pending_ = false;
+  }
+
 protected:
-  shared_queue() : pending_(0) {
+  shared_queue() : pending_(0), resume_pending_(false) {
     // nop
   }
 
+  // --- bookkeeping for the metrics, requires holding `mtx_` -------------------
+
+  /// Records that `n` items entered `xs_`.
+  void on_enqueue(size_t n) {
+    if (n == 0)
+      return;
+    marks_.push_back(enqueue_mark{n, queue_stats::clock_type::now()});
+    stats_.on_enqueue(n);
+  }
+
+  /// Records that `n` items left the front of `xs_`. Passing `dropped = true`
+  /// records the items as discarded instead of consumed.
+  void on_dequeue(size_t n, bool dropped = false) {
+    if (n == 0)
+      return;
+    if (dropped)
+      stats_.on_drop(n);
+    auto now = queue_stats::clock_type::now();
+    while (n > 0) {
+      auto& mark = marks_.front();
+      auto k = std::min(n, mark.count);
+      if (!dropped)
+        stats_.on_dequeue(k, now - mark.time);
+      n -= k;
+      mark.count -= k;
+      if (mark.count == 0)
+        marks_.pop_front();
+    }
+  }
+
   /// Guards access to `xs`.
   mutable std::mutex mtx_;
 
@@ -92,9 +145,18 @@ protected:
   /// versa, depending on the message direction.
   std::atomic<long> pending_;
 
-  /// Stores consumption or production rate.
-  std::atomic<size_t> rate_;
+  /// Counts items passing through the queue.
+  queue_stats stats_;
+
+  /// Stores when the items in `xs_` entered the queue.
+  std::deque<enqueue_mark> marks_;
+
+  /// Signals whether a resume message to the worker is in flight.
+  std::atomic<bool> resume_pending_;
 };
 
+template <class ValueType = data_message>
+using shared_queue_ptr = caf::intrusive_ptr<shared_queue<ValueType>>;
+
 } // namespace detail
 } // namespace broker
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <iterator>
 #include <vector>
+
 #include <caf/intrusive_ptr.hpp>
 #include <caf/make_counted.hpp>
 
 #include "broker/detail/shared_queue.hh"
+#include "broker/detail/spsc_queue.hh"
 #include "broker/message.hh"
+#include "broker/overflow_policy.hh"
+#include "broker/queue_kind.hh"
 
 namespace broker {
 namespace detail {
@@ -20,6 +25,18 @@ namespace detail {
 /// - the flare is active as long as xs_ has more than one item
 /// - produce() fires the flare when it adds items to xs_ and xs_ was empty
 /// - consume() extinguishes the flare when it removes the last item from xs_
+///
+/// With `queue_kind::lock_free`, the queue stores items in an `spsc_queue`
+/// instead of `xs_` and never locks the mutex. Since the producer fires the
+/// flare only after publishing its items, the consumer may observe the items
+/// before the flare. Hence, the consumer drains the flare completely whenever
+/// it finds the queue empty and fires it again if the producer added items in
+/// the meantime.
+///
+/// When bounding the queue via `produce_bounded`, the producer may only add
+/// items to the lock-free queue. Hence, `overflow_policy::drop_oldest`
+/// discards the oldest items of the incoming range instead of buffered items
+/// in lock-free mode.
 template <class ValueType = data_message>
 class shared_subscriber_queue : public shared_queue<ValueType> {
 public:
@@ -29,12 +46,46 @@ public:
 
   using guard_type = typename super::guard_type;
 
-  shared_subscriber_queue() = default;
+  explicit shared_subscriber_queue(queue_kind kind = queue_kind::locked)
+    : kind_(kind) {
+    // nop
+  }
+
+  queue_kind kind() const noexcept {
+    return kind_;
+  }
+
+  // Returns the number of items that `produce_bounded` discarded so far.
+  size_t dropped() const {
+    return this->stats_.dropped();
+  }
+
+  queue_metrics metrics(std::string name) const override {
+    auto result = this->stats_.metrics(std::move(name));
+    result.buffered = buffer_size();
+    return result;
+  }
+
+  // Returns the number of buffered items without locking the mutex.
+  size_t buffer_size() const {
+    if (kind_ == queue_kind::lock_free)
+      return ring_.size();
+    return size_.load();
+  }
 
   // Called to pull up to `num` items out of the queue. Returns the number of
   // consumed elements.
   template <class F>
   size_t consume(size_t num, size_t* size_before_consume, F fun) {
+    if (kind_ == queue_kind::lock_free) {
+      auto [n, prev_size] = ring_.pop(num, fun);
+      on_ring_dequeue(n);
+      if (n > 0 && size_before_consume)
+        *size_before_consume = prev_size;
+      if (n == prev_size)
+        rekindle();
+      return n;
+    }
     guard_type guard{this->mtx_};
     if (this->xs_.empty())
       return 0;
@@ -53,25 +104,40 @@ public:
         fun(std::move(*i));
       this->xs_.erase(b, e);
     }
+    this->on_dequeue(n);
+    size_ = this->xs_.size();
     return n;
   }
 
-  std::vector<value_type> consume_all() {
+  // Passes all items in the queue to `fun`. Returns the number of consumed
+  // elements.
+  template <class F>
+  size_t consume_all(F fun) {
+    if (kind_ == queue_kind::lock_free) {
+      auto n = ring_.size();
+      auto got = ring_.pop(n, fun).first;
+      on_ring_dequeue(got);
+      if (got == n)
+        rekindle();
+      return got;
+    }
     guard_type guard{this->mtx_};
-
-    std::vector<value_type> rval;
-
-    if (this->xs_.empty())
-      return rval;
-
-    rval.reserve(this->xs_.size());
-
+    auto n = this->xs_.size();
+    if (n == 0)
+      return 0;
     for (auto& x : this->xs_)
-      rval.emplace_back(std::move(x));
-
+      fun(std::move(x));
     this->xs_.clear();
     this->fx_.extinguish_one();
+    this->on_dequeue(n);
+    size_ = 0;
+    return n;
+  }
 
+  std::vector<value_type> consume_all() {
+    std::vector<value_type> rval;
+    rval.reserve(buffer_size());
+    consume_all([&rval](value_type&& x) { rval.emplace_back(std::move(x)); });
     return rval;
   }
 
@@ -80,19 +146,148 @@ public:
   void produce(size_t num, Iter i, Iter e) {
     CAF_IGNORE_UNUSED(num);
     CAF_ASSERT(num == std::distance(i, e));
+    if (kind_ == queue_kind::lock_free) {
+      on_ring_enqueue(num);
+      if (ring_.push(i, e) == 0)
+        this->fx_.fire();
+      return;
+    }
     guard_type guard{this->mtx_};
     if (this->xs_.empty())
       this->fx_.fire();
     this->xs_.insert(this->xs_.end(), i, e);
+    this->on_enqueue(num);
+    size_ = this->xs_.size();
+  }
+
+  // Inserts the range `[i, e)` into the queue without exceeding `max_size`
+  // items, discarding items according to `policy`. Returns the number of
+  // discarded items.
+  template <class Iter>
+  size_t produce_bounded(overflow_policy policy, size_t max_size, Iter i,
+                         Iter e) {
+    auto num = static_cast<size_t>(std::distance(i, e));
+    if (policy == overflow_policy::block) {
+      produce(num, i, e);
+      return 0;
+    }
+    if (policy == overflow_policy::drop_oldest && kind_ == queue_kind::locked)
+      return produce_dropping_oldest(max_size, i, e);
+    auto size = buffer_size();
+    auto space = size < max_size ? max_size - size : size_t{0};
+    if (num <= space) {
+      produce(num, i, e);
+      return 0;
+    }
+    std::vector<value_type> xs;
+    xs.reserve(space);
+    switch (policy) {
+      case overflow_policy::drop_oldest:
+        std::advance(i, static_cast<ptrdiff_t>(num - space));
+        xs.insert(xs.end(), i, e);
+        break;
+      case overflow_policy::sample:
+        // Keeps `space` items at evenly spaced positions.
+        for (size_t pos = 0; i != e; ++i, ++pos)
+          if ((pos + 1) * space / num != pos * space / num)
+            xs.emplace_back(*i);
+        break;
+      default: // overflow_policy::drop_newest
+        for (size_t n = 0; n < space; ++i, ++n)
+          xs.emplace_back(*i);
+    }
+    if (!xs.empty())
+      produce(xs.size(), std::make_move_iterator(xs.begin()),
+              std::make_move_iterator(xs.end()));
+    auto dropped = num - xs.size();
+    this->stats_.on_drop(dropped);
+    return dropped;
   }
 
   // Inserts `x` into the queue.
   void produce(ValueType x) {
+    if (kind_ == queue_kind::lock_free) {
+      on_ring_enqueue(1);
+      if (ring_.push(std::move(x)) == 0)
+        this->fx_.fire();
+      return;
+    }
     guard_type guard{this->mtx_};
     if (this->xs_.empty())
       this->fx_.fire();
     this->xs_.emplace_back(std::move(x));
+    this->on_enqueue(1);
+    size_ = this->xs_.size();
+  }
+
+private:
+  // Implements `produce_bounded` for `drop_oldest` on the locked queue.
+  template <class Iter>
+  size_t produce_dropping_oldest(size_t max_size, Iter i, Iter e) {
+    guard_type guard{this->mtx_};
+    auto& xs = this->xs_;
+    auto was_empty = xs.empty();
+    auto old_size = xs.size();
+    xs.insert(xs.end(), i, e);
+    this->on_enqueue(xs.size() - old_size);
+    size_t dropped = 0;
+    if (xs.size() > max_size) {
+      dropped = xs.size() - max_size;
+      xs.erase(xs.begin(), xs.begin() + static_cast<ptrdiff_t>(dropped));
+      this->on_dequeue(dropped, true);
+    }
+    if (was_empty && !xs.empty())
+      this->fx_.fire();
+    size_ = xs.size();
+    return dropped;
+  }
+
+  // Records that `n` items enter `ring_`. Must run before adding the items
+  // to make the mark visible to the consumer before the items.
+  void on_ring_enqueue(size_t n) {
+    if (n == 0)
+      return;
+    ring_marks_.push(enqueue_mark{n, queue_stats::clock_type::now()});
+    this->stats_.on_enqueue(n);
+  }
+
+  // Records that the consumer removed `n` items from `ring_`.
+  void on_ring_dequeue(size_t n) {
+    if (n == 0)
+      return;
+    auto now = queue_stats::clock_type::now();
+    auto f = [this](enqueue_mark&& x) { ring_mark_ = x; };
+    while (n > 0) {
+      if (ring_mark_.count == 0)
+        ring_marks_.pop(1, f);
+      auto k = std::min(n, ring_mark_.count);
+      this->stats_.on_dequeue(k, now - ring_mark_.time);
+      n -= k;
+      ring_mark_.count -= k;
+    }
+  }
+
+  // Resets the flare after the consumer found the lock-free queue empty.
+  void rekindle() {
+    this->fx_.extinguish();
+    if (!ring_.empty())
+      this->fx_.fire();
   }
+
+  /// Selects between `xs_` and `ring_`.
+  queue_kind kind_;
+
+  /// Mirrors `xs_.size()` for reading the size without locking the mutex.
+  std::atomic<size_t> size_{0};
+
+  /// Stores when the items in `ring_` entered the queue.
+  spsc_queue<enqueue_mark> ring_marks_;
+
+  /// Mark for the next items in `ring_`. Only accessed by the consumer.
+  enqueue_mark ring_mark_{0, {}};
+
+  /// Buffers values received by the worker in lock-free mode.
+  spsc_queue<value_type> ring_;
 };
 
 template <class ValueType = data_message>
@@ -100,8 +295,9 @@ using shared_subscriber_queue_ptr
   = caf::intrusive_ptr<shared_subscriber_queue<ValueType>>;
 
 template <class ValueType = data_message>
-shared_subscriber_queue_ptr<ValueType> make_shared_subscriber_queue() {
-  return caf::make_counted<shared_subscriber_queue<ValueType>>();
+shared_subscriber_queue_ptr<ValueType>
+make_shared_subscriber_queue(queue_kind kind = queue_kind::locked) {
+  return caf::make_counted<shared_subscriber_queue<ValueType>>(kind);
 }
 
 } // namespace detail
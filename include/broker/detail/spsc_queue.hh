@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace broker {
+namespace detail {
+
+/// A lock-free, unbounded queue for exactly one producer thread and exactly
+/// one consumer thread. Stores elements in a ring of fixed-size blocks: the
+/// producer appends new blocks as needed and the consumer hands drained blocks
+/// back for reuse, so a queue in steady state never allocates.
+template <class T, size_t BlockSize = 256>
+class spsc_queue {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using value_type = T;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  spsc_queue() {
+    head_ = tail_ = new block;
+  }
+
+  spsc_queue(const spsc_queue&) = delete;
+
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  ~spsc_queue() {
+    auto n = size_.load();
+    while (n-- > 0)
+      pop_front();
+    for (auto ptr = head_; ptr != nullptr;) {
+      auto next = ptr->next.load();
+      delete ptr;
+      ptr = next;
+    }
+    delete spare_.load();
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the number of elements in the queue. Both threads may call this
+  /// function.
+  size_t size() const noexcept {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  /// Returns whether the queue is empty. Both threads may call this function.
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // -- producer interface -----------------------------------------------------
+
+  /// Appends all elements in `[first, last)` to the queue.
+  /// @returns The size of the queue before adding the new elements.
+  template <class Iterator>
+  size_t push(Iterator first, Iterator last) {
+    size_t n = 0;
+    for (; first != last; ++first, ++n)
+      emplace_back(*first);
+    return size_.fetch_add(n, std::memory_order_acq_rel);
+  }
+
+  /// Appends `x` to the queue.
+  /// @returns The size of the queue before adding the new element.
+  size_t push(T x) {
+    emplace_back(std::move(x));
+    return size_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  // -- consumer interface -----------------------------------------------------
+
+  /// Removes up to `num` elements from the queue and passes them to `f`.
+  /// @returns The number of removed elements and the size of the queue before
+  ///          removing them.
+  template <class F>
+  std::pair<size_t, size_t> pop(size_t num, F& f) {
+    auto available = size_.load(std::memory_order_acquire);
+    auto n = std::min(num, available);
+    for (size_t i = 0; i < n; ++i) {
+      f(std::move(front()));
+      pop_front();
+    }
+    if (n > 0)
+      available = size_.fetch_sub(n, std::memory_order_acq_rel);
+    return {n, available};
+  }
+
+private:
+  using storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  struct block {
+    storage slots[BlockSize];
+    std::atomic<block*> next{nullptr};
+  };
+
+  // -- producer-side helpers --------------------------------------------------
+
+  template <class U>
+  void emplace_back(U&& x) {
+    if (tail_pos_ == BlockSize) {
+      auto ptr = spare_.exchange(nullptr, std::memory_order_acquire);
+      if (ptr == nullptr)
+        ptr = new block;
+      else
+        ptr->next.store(nullptr, std::memory_order_relaxed);
+      // The consumer reads `next` only after seeing the new size.
+      tail_->next.store(ptr, std::memory_order_relaxed);
+      tail_ = ptr;
+      tail_pos_ = 0;
+    }
+    new (&tail_->slots[tail_pos_++]) T(std::forward<U>(x));
+  }
+
+  // -- consumer-side helpers --------------------------------------------------
+
+  T& front() {
+    if (head_pos_ == BlockSize) {
+      auto next = head_->next.load(std::memory_order_acquire);
+      recycle(head_);
+      head_ = next;
+      head_pos_ = 0;
+    }
+    return *std::launder(reinterpret_cast<T*>(&head_->slots[head_pos_]));
+  }
+
+  void pop_front() {
+    front().~T();
+    ++head_pos_;
+  }
+
+  void recycle(block* ptr) {
+    if (auto old = spare_.exchange(ptr, std::memory_order_release))
+      delete old;
+  }
+
+  // -- member variables -------------------------------------------------------
+
+  /// Number of elements that the producer has published to the consumer.
+  alignas(64) std::atomic<size_t> size_{0};
+
+  /// Block that the producer writes to. Only accessed by the producer.
+  alignas(64) block* tail_;
+
+  /// Next free slot in `tail_`.
+  size_t tail_pos_ = 0;
+
+  /// Block that the consumer reads from. Only accessed by the consumer.
+  alignas(64) block* head_;
+
+  /// Next unread slot in `head_`.
+  size_t head_pos_ = 0;
+
+  /// Drained block that the producer may reuse.
+  alignas(64) std::atomic<block*> spare_{nullptr};
+};
+
+} // namespace detail
+} // namespace broker
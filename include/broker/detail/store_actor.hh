@@ -1,9 +1,13 @@
 #pragma once
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/event_based_actor.hpp>
+#include <caf/make_message.hpp>
+#include <caf/message.hpp>
 
 #include "broker/endpoint.hh"
 #include "broker/optional.hh"
@@ -68,6 +72,20 @@ public:
     emit_expire_event(msg.key, msg.publisher);
   }
 
+  /// Sends a message with the content `xs` to `dst`. While `defer_output` is
+  /// `true`, stores the message until calling `flush_output` instead.
+  template <class... Ts>
+  void send_or_defer(const caf::actor& dst, Ts&&... xs) {
+    if (defer_output)
+      deferred_output.emplace_back(dst,
+                                   caf::make_message(std::forward<Ts>(xs)...));
+    else
+      self->send(dst, std::forward<Ts>(xs)...);
+  }
+
+  /// Sends all messages that `send_or_defer` stored while deferring output.
+  void flush_output();
+
   /// Points to the actor owning this state.
   caf::event_based_actor* self = nullptr;
 
@@ -82,6 +100,14 @@ public:
 
   /// Destination for emitted events.
   topic dst;
+
+  /// Stores all outgoing messages in `deferred_output` if `true`. Allows
+  /// masters to hold back events and updates for clones until the backend
+  /// committed a batch of changes.
+  bool defer_output = false;
+
+  /// Messages for `flush_output`.
+  std::vector<std::pair<caf::actor, caf::message>> deferred_output;
 };
 
 } // namespace broker::detail
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <caf/actor.hpp>
+
+#include "broker/detail/shared_subscriber_queue.hh"
+#include "broker/fwd.hh"
+#include "broker/overflow_policy.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+/// Selects the queue for messages on a topic. The worker reduces the result
+/// modulo the number of queues.
+using shard_function = std::function<size_t(const topic&)>;
+
+/// Spawns the background worker of a subscriber. The worker subscribes to
+/// `ts` at the core of `ep` and moves each received message into one of the
+/// `queues`, selected by `f`. Passing a single queue disables sharding.
+/// @pre `!queues.empty()`
+caf::actor
+spawn_subscriber_worker(endpoint& ep,
+                        std::vector<shared_subscriber_queue_ptr<>> queues,
+                        shard_function f, std::vector<topic> ts,
+                        size_t max_qsize, overflow_policy policy);
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+/// Replaces repeated topics on a single peering with small IDs. Works like the
+/// topic table of the ::generator_file_writer: the first message on a topic
+/// carries the string together with a new ID and all subsequent messages only
+/// carry the ID. Each outbound path to a peer owns one encoder and each inbound
+/// path from a peer owns one ::topic_decoder. Both start out empty when the
+/// handshake creates the paths. Since the decoder relies on receiving all
+/// messages in order, the core drops a peering once decoding fails.
+/// @note The handshake does not negotiate the dictionary. Peers learn entries
+///       in-band and rely on protocol version 3 to keep out peers without
+///       dictionary support. IDs go over the wire as fixed 16-bit integers
+///       plus the `topic_elided` flag, i.e., three bytes instead of a varint.
+class topic_encoder {
+public:
+  /// Maximum number of dictionary entries. Messages on additional topics
+  /// always carry their topic string.
+  static constexpr size_t max_size = std::numeric_limits<uint16_t>::max();
+
+  /// Assigns a dictionary ID to the topic of `x` and elides the topic string
+  /// if the receiver already knows the ID.
+  template <class PeerId>
+  void encode(generic_node_message<PeerId>& x) {
+    auto& t = get_topic(x.content);
+    if (auto i = ids_.find(t); i != ids_.end()) {
+      x.topic_id = i->second;
+      x.topic_elided = true;
+      return;
+    }
+    x.topic_elided = false;
+    if (ids_.size() >= max_size) {
+      x.topic_id = 0;
+      return;
+    }
+    auto id = static_cast<uint16_t>(ids_.size() + 1);
+    ids_.emplace(t, id);
+    x.topic_id = id;
+  }
+
+  /// Returns the number of dictionary entries.
+  size_t size() const noexcept {
+    return ids_.size();
+  }
+
+private:
+  std::unordered_map<topic, uint16_t> ids_;
+};
+
+/// Restores topics that a ::topic_encoder elided on the wire.
+class topic_decoder {
+public:
+  /// Learns new dictionary entries from `x` and restores the topic of `x` if
+  /// the sender elided it. Resets the dictionary fields of `x` afterwards,
+  /// because they only have a meaning on this peering.
+  /// @returns `false` if `x` refers to an unknown dictionary ID.
+  template <class PeerId>
+  bool decode(generic_node_message<PeerId>& x) {
+    auto id = x.topic_id;
+    auto elided = x.topic_elided;
+    x.topic_id = 0;
+    x.topic_elided = false;
+    if (id == 0)
+      return true;
+    if (!elided) {
+      if (topics_.size() < id)
+        topics_.resize(id);
+      topics_[id - 1] = get_topic(x.content);
+      return true;
+    }
+    // Messages between actors in the same process bypass serialization and
+    // still carry their topic.
+    if (!get_topic(x.content).string().empty())
+      return true;
+    if (topics_.size() < id)
+      return false;
+    if (is_data_message(x.content))
+      get<0>(caf::get<data_message>(x.content).unshared()) = topics_[id - 1];
+    else
+      get<0>(caf::get<command_message>(x.content).unshared()) = topics_[id - 1];
+    return true;
+  }
+
+  /// Returns the number of dictionary entries.
+  size_t size() const noexcept {
+    return topics_.size();
+  }
+
+private:
+  std::vector<topic> topics_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "broker/detail/radix_tree.hh"
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+/// Maps subscriptions to user-defined IDs, e.g., the position of an outbound
+/// path in a downstream manager. Answers "which IDs match this topic" with a
+/// single walk over the topic instead of one prefix match per ID and filter
+/// entry. The index also caches the result per topic, because most traffic
+/// uses only a handful of distinct topics. Hence, routing a message usually
+/// costs a single hash lookup. For interned topics, the index uses the topic
+/// ID as cache key and never hashes the string.
+class topic_index {
+public:
+  /// Type of a user-defined ID.
+  using id_type = size_t;
+
+  /// Sorted list of IDs without duplicates.
+  using id_list = std::vector<id_type>;
+
+  /// Maximum number of cached lookups. The index drops all cached entries when
+  /// reaching this limit.
+  static constexpr size_t max_cache_size = 1024;
+
+  topic_index() = default;
+
+  topic_index(const topic_index&) = delete;
+
+  topic_index& operator=(const topic_index&) = delete;
+
+  /// Removes all entries.
+  void clear();
+
+  /// Subscribes `id` to all topics in `filter`. Invalidates the cache.
+  void add(id_type id, const filter_type& filter);
+
+  /// Returns all IDs with at least one subscription that is a prefix of `t`.
+  /// @warning The result remains valid only until the next call to any
+  ///          member function of this index.
+  const id_list& matches(const topic& t);
+
+  /// Returns whether the index contains no subscriptions.
+  bool empty() const noexcept {
+    return tree_.empty();
+  }
+
+  /// Returns the number of cached lookups.
+  size_t cache_size() const noexcept {
+    return cache_.size() + id_cache_.size();
+  }
+
+private:
+  /// Stores all IDs with a subscription that is a prefix of `str` in `result`.
+  void lookup(const std::string& str, id_list& result) const;
+
+  /// Makes room for a new cache entry.
+  void prepare_cache_insert();
+
+  /// Maps subscribed prefixes to IDs.
+  radix_tree<id_list> tree_;
+
+  /// Caches the results of previous lookups for regular topics.
+  std::unordered_map<std::string, id_list> cache_;
+
+  /// Caches the results of previous lookups for interned topics.
+  std::unordered_map<uint32_t, id_list> id_cache_;
+
+  /// Returned for any lookup on an empty index.
+  id_list empty_result_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace broker {
+namespace detail {
+
+/// Immutable, process-wide representation of a topic string.
+struct interned_topic {
+  /// Stable, non-zero ID of this topic within the current process.
+  uint32_t id;
+
+  /// Precomputed hash of `str`. Equal to `std::hash<std::string>{}(str)`.
+  size_t hash;
+
+  /// The topic string.
+  std::string str;
+
+  /// Start offset and length of each component in `str` as returned by
+  /// `topic::split`.
+  std::vector<std::pair<size_t, size_t>> segments;
+};
+
+/// Maps topic strings to interned representations. Entries remain valid for
+/// the lifetime of the process. IDs only have a meaning within the local
+/// process and never go over the wire.
+class topic_intern_table {
+public:
+  /// Maximum number of entries. The table refuses to intern any topic after
+  /// reaching this limit to bound memory usage in applications that generate
+  /// topics dynamically.
+  static constexpr size_t max_size = 65536;
+
+  /// Returns the interned representation of `str` or `nullptr` if the table
+  /// is full.
+  const interned_topic* intern(const std::string& str);
+
+  /// Returns the number of interned topics.
+  size_t size() const;
+
+  /// Returns the process-wide table.
+  static topic_intern_table& instance();
+
+private:
+  /// Guards `entries_` and `lookup_`.
+  mutable std::shared_mutex mtx_;
+
+  /// Stores all interned topics. A deque never relocates its elements.
+  std::deque<interned_topic> entries_;
+
+  /// Maps strings to entries. The keys point into `entries_`.
+  std::unordered_map<std::string_view, const interned_topic*> lookup_;
+};
+
+} // namespace detail
+} // namespace broker
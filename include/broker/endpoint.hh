@@ -22,13 +22,20 @@
 #include "broker/backend.hh"
 #include "broker/backend_options.hh"
 #include "broker/configuration.hh"
+#include "broker/detail/core_stats.hh"
+#include "broker/detail/ingress_queue.hh"
 #include "broker/endpoint_info.hh"
 #include "broker/expected.hh"
 #include "broker/frontend.hh"
 #include "broker/fwd.hh"
 #include "broker/message.hh"
 #include "broker/network_info.hh"
+#include "broker/overflow_policy.hh"
 #include "broker/peer_info.hh"
+#include "broker/peer_metrics.hh"
+#include "broker/queue_kind.hh"
+#include "broker/queue_metrics.hh"
+#include "broker/sharded_subscriber.hh"
 #include "broker/status.hh"
 #include "broker/status_subscriber.hh"
 #include "broker/store.hh"
@@ -206,8 +213,17 @@ public:
   // Publishes all messages in `xs`.
   void publish(std::vector<data_message> xs);
 
+  /// Returns a publisher for the topic `ts` that buffers up to
+  /// `broker_options::publisher_queue_size` messages.
   publisher make_publisher(topic ts);
 
+  /// Returns a publisher for the topic `ts`.
+  /// @param capacity Number of buffered messages before `publish` blocks.
+  /// @param max_capacity Upper bound for growing the buffer while the core
+  ///                     keeps draining it completely. A value not greater
+  ///                     than `capacity` disables growing.
+  publisher make_publisher(topic ts, size_t capacity, size_t max_capacity = 0);
+
   /// Starts a background worker from the given set of functions that publishes
   /// a series of messages. The worker will run in the background, but `init`
   /// is guaranteed to be called before the function returns.
@@ -248,7 +264,48 @@ public:
   // --- subscribing data ------------------------------------------------------
 
   /// Returns a subscriber connected to this endpoint for the topics `ts`.
-  subscriber make_subscriber(std::vector<topic> ts, size_t max_qsize = 20u);
+  /// @param max_qsize Number of buffered messages before the subscriber stops
+  ///                  granting credit to the core.
+  /// @param kind Selects the queue between the subscriber and its background
+  ///             worker. A `queue_kind::lock_free` queue avoids locking on
+  ///             both ends, but requires that only one thread at a time
+  ///             reads from the subscriber.
+  /// @param policy Selects how the subscriber handles messages that arrive
+  ///               while it buffers `max_qsize` messages. Any policy other
+  ///               than `overflow_policy::block` discards messages instead of
+  ///               withholding credit, i.e., a slow subscriber no longer slows
+  ///               down the core.
+  subscriber make_subscriber(std::vector<topic> ts, size_t max_qsize = 20u,
+                             queue_kind kind = queue_kind::locked,
+                             overflow_policy policy = overflow_policy::block);
+
+  /// Returns a subscriber connected to this endpoint for the topics `ts` that
+  /// distributes messages over `num_shards` independent queues.
+  /// @param f Maps the topic of a message to its shard. Defaults to hashing
+  ///          the topic.
+  /// @param max_qsize Number of buffered messages per shard before the
+  ///                  subscriber stops granting credit to the core.
+  /// @param kind Selects the queue of each shard.
+  /// @param policy Selects how each shard handles messages that arrive while
+  ///               it buffers `max_qsize` messages.
+  sharded_subscriber
+  make_sharded_subscriber(std::vector<topic> ts, size_t num_shards,
+                          sharded_subscriber::shard_function f = nullptr,
+                          size_t max_qsize = 20u,
+                          queue_kind kind = queue_kind::locked,
+                          overflow_policy policy = overflow_policy::block);
+
+  // --- metrics ---------------------------------------------------------------
+
+  /// Returns the counters and latency percentiles for the queues of all
+  /// publishers and subscribers that this endpoint created. Reading the
+  /// metrics never blocks on or sends messages to the background workers.
+  std::vector<queue_metrics> metrics();
+
+  /// Returns the counters for the traffic between this endpoint and its
+  /// peers. Like `metrics`, this function never blocks on or sends messages to
+  /// the core.
+  peer_metrics peering_metrics() const;
 
   /// Starts a background worker from the given set of function that consumes
   /// incoming messages. The worker will run in the background, but `init` is
@@ -378,13 +435,20 @@ protected:
 private:
   caf::actor make_actor(actor_init_fun f);
 
+  /// Makes the queue of a publisher or subscriber visible to `metrics`.
+  void register_queue(std::string name, detail::shared_queue_ptr<> q);
+
   configuration config_;
   union {
     mutable caf::actor_system system_;
   };
   caf::actor core_;
+  detail::ingress_queue_ptr ingress_;
+  detail::core_stats_ptr stats_;
   bool await_stores_on_shutdown_;
   std::vector<caf::actor> children_;
+  std::mutex queues_mtx_;
+  std::vector<std::pair<std::string, detail::shared_queue_ptr<>>> queues_;
   bool destroyed_;
   clock* clock_;
 };
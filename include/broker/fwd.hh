@@ -27,6 +27,8 @@ struct put_command;
 struct put_unique_command;
 struct set_command;
 struct snapshot_command;
+struct snapshot_delta;
+struct snapshot_entry;
 struct snapshot_sync_command;
 struct subtract_command;
 
@@ -39,6 +41,7 @@ class endpoint;
 class internal_command;
 class port;
 class publisher;
+class sharded_subscriber;
 class status;
 class store;
 class subnet;
@@ -49,6 +52,7 @@ class topic;
 
 enum class backend : uint8_t;
 enum class ec : uint8_t;
+enum class node_message_flags : uint8_t;
 enum class sc : uint8_t;
 
 // -- templates ----------------------------------------------------------------
@@ -108,9 +112,14 @@ namespace broker::detail {
 
 struct retry_state;
 
+class core_stats;
 class flare_actor;
+class ingress_queue;
 class mailbox;
 
+using core_stats_ptr = caf::intrusive_ptr<core_stats>;
+using ingress_queue_ptr = caf::intrusive_ptr<ingress_queue>;
+
 } // namespace broker::detail
 
 // -- imported atoms -----------------------------------------------------------
@@ -199,6 +208,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker, caf::first_custom_type_id)
 
   // -- atoms for communciation with the core actor ----------------------------
 
+  BROKER_ADD_ATOM(metrics, "metrics")
   BROKER_ADD_ATOM(no_events, "noEvents")
   BROKER_ADD_ATOM(snapshot, "snapshot")
   BROKER_ADD_ATOM(subscriptions, "subs")
@@ -211,6 +221,8 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::command_message))
   BROKER_ADD_TYPE_ID((broker::data))
   BROKER_ADD_TYPE_ID((broker::data_message))
+  BROKER_ADD_TYPE_ID((broker::detail::core_stats_ptr))
+  BROKER_ADD_TYPE_ID((broker::detail::ingress_queue_ptr))
   BROKER_ADD_TYPE_ID((broker::detail::retry_state))
   BROKER_ADD_TYPE_ID((broker::ec))
   BROKER_ADD_TYPE_ID((broker::endpoint_info))
@@ -220,6 +232,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::network_info))
   BROKER_ADD_TYPE_ID((broker::node_message))
   BROKER_ADD_TYPE_ID((broker::node_message_content))
+  BROKER_ADD_TYPE_ID((broker::node_message_flags))
   BROKER_ADD_TYPE_ID((broker::optional<broker::timespan>) )
   BROKER_ADD_TYPE_ID((broker::optional<broker::timestamp>) )
   BROKER_ADD_TYPE_ID((broker::peer_info))
@@ -228,6 +241,8 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::set))
   BROKER_ADD_TYPE_ID((broker::set_command))
   BROKER_ADD_TYPE_ID((broker::snapshot))
+  BROKER_ADD_TYPE_ID((broker::snapshot_delta))
+  BROKER_ADD_TYPE_ID((broker::snapshot_entry))
   BROKER_ADD_TYPE_ID((broker::status))
   BROKER_ADD_TYPE_ID((broker::subnet))
   BROKER_ADD_TYPE_ID((broker::table))
@@ -240,11 +255,13 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((caf::stream<broker::data_message>) )
   BROKER_ADD_TYPE_ID((caf::stream<broker::node_message>) )
   BROKER_ADD_TYPE_ID((caf::stream<broker::node_message_content>) )
+  BROKER_ADD_TYPE_ID((caf::stream<broker::snapshot_entry>) )
   BROKER_ADD_TYPE_ID((std::vector<broker::command_message>) )
   BROKER_ADD_TYPE_ID((std::vector<broker::data_message>) )
   BROKER_ADD_TYPE_ID((std::vector<broker::node_message>) )
   BROKER_ADD_TYPE_ID((std::vector<broker::node_message_content>) )
   BROKER_ADD_TYPE_ID((std::vector<broker::peer_info>) )
+  BROKER_ADD_TYPE_ID((std::vector<broker::snapshot_entry>) )
 
 CAF_END_TYPE_ID_BLOCK(broker)
 
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <utility>
 #include <unordered_map>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/variant.hpp>
@@ -102,11 +104,16 @@ typename Inspector::result_type inspect(Inspector& f, subtract_command& x) {
 struct snapshot_command {
   caf::actor remote_core;
   caf::actor remote_clone;
+  /// Sequence number of the last command from the master that the clone has
+  /// applied. Allows the master to reply with the missed commands only instead
+  /// of a full snapshot. A value of 0 always requests a full snapshot.
+  uint64_t seq = 0;
 };
 
 template <class Inspector>
 typename Inspector::result_type inspect(Inspector& f, snapshot_command& x) {
-  return f(caf::meta::type_name("snapshot"), x.remote_core, x.remote_clone);
+  return f(caf::meta::type_name("snapshot"), x.remote_core, x.remote_clone,
+           x.seq);
 }
 
 /// Since snapshots are sent to clones on a different channel, this allows
@@ -131,6 +138,19 @@ typename Inspector::result_type inspect(Inspector& f, set_command& x) {
   return f(caf::meta::type_name("set"), x.state);
 }
 
+/// A single key-value pair of a snapshot. Instead of sending the entire state
+/// in a single `set_command`, masters stream snapshots to clones as a sequence
+/// of entries.
+struct snapshot_entry {
+  data key;
+  data value;
+};
+
+template <class Inspector>
+typename Inspector::result_type inspect(Inspector& f, snapshot_entry& x) {
+  return f(caf::meta::type_name("snapshot_entry"), x.key, x.value);
+}
+
 /// Drops all values.
 struct clear_command {
   publisher_id publisher;
@@ -165,6 +185,11 @@ public:
 
   variant_type content;
 
+  /// Position of this command in the sequence of commands that a master sends
+  /// to its clones. Masters start counting at 1, i.e., 0 marks commands that
+  /// have no sequence number.
+  uint64_t seq = 0;
+
   internal_command(variant_type value);
 
   internal_command() = default;
@@ -181,7 +206,19 @@ internal_command make_internal_command(Ts&&... xs) {
 
 template <class Inspector>
 typename Inspector::result_type inspect(Inspector& f, internal_command& x) {
-  return f(caf::meta::type_name("internal_command"), x.content);
+  return f(caf::meta::type_name("internal_command"), x.content, x.seq);
+}
+
+/// Carries all commands that a clone missed since its last sequence number.
+/// Masters send this instead of a snapshot to clones that reconnect after a
+/// brief outage.
+struct snapshot_delta {
+  std::vector<internal_command> commands;
+};
+
+template <class Inspector>
+typename Inspector::result_type inspect(Inspector& f, snapshot_delta& x) {
+  return f(caf::meta::type_name("snapshot_delta"), x.commands);
 }
 
 namespace detail {
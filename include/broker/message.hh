@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <type_traits>
 
 #include <caf/cow_tuple.hpp>
 #include <caf/variant.hpp>
@@ -11,6 +13,33 @@
 
 namespace broker {
 
+/// Routing flags for node messages.
+enum class node_message_flags : uint8_t {
+  none = 0x00,
+  /// Receivers must not forward the message to other peers.
+  no_forward = 0x01,
+};
+
+/// @relates node_message_flags
+constexpr node_message_flags operator+(node_message_flags lhs,
+                                       node_message_flags rhs) {
+  return static_cast<node_message_flags>(static_cast<uint8_t>(lhs)
+                                         | static_cast<uint8_t>(rhs));
+}
+
+/// @relates node_message_flags
+constexpr bool has_node_message_flags(node_message_flags haystack,
+                                      node_message_flags needle) {
+  return (static_cast<uint8_t>(haystack) & static_cast<uint8_t>(needle)) != 0;
+}
+
+/// @relates node_message_flags
+inline std::string to_string(node_message_flags x) {
+  if (has_node_message_flags(x, node_message_flags::no_forward))
+    return "no_forward";
+  return "none";
+}
+
 /// A user-defined message with topic and data.
 using data_message = caf::cow_tuple<topic, data>;
 
@@ -33,8 +62,36 @@ struct generic_node_message {
   /// Time-to-life counter.
   uint16_t ttl;
 
-  /// Receivers of this message.
-  receiver_list receivers;
+  /// Routing flags, set once by the publishing peer and never changed while
+  /// forwarding the message.
+  node_message_flags flags = node_message_flags::none;
+
+  /// Nodes that already received or are about to receive this message, with
+  /// the originating node first. Empty if the sender disabled source routing.
+  /// See ::detail::peer_downstream_manager.
+  receiver_list receivers = {};
+
+  /// Node that published this message.
+  PeerId origin = {};
+
+  /// Random number that the publishing core picked at startup. Distinguishes
+  /// cores that share the same `origin`, e.g., multiple endpoints in one
+  /// process.
+  uint64_t epoch = 0;
+
+  /// Sequence number that the publishing core assigned to this message or 0
+  /// if it did not assign one. Together with `origin` and `epoch`, the
+  /// sequence number identifies a message in the network.
+  uint64_t seq = 0;
+
+  /// Identifies the topic of `content` in the topic dictionary of the peering
+  /// that carries this message or 0 if the topic has no dictionary entry. Only
+  /// meaningful between two directly connected peers.
+  uint16_t topic_id = 0;
+
+  /// Signals that the receiving peer knows `topic_id` already. Such messages
+  /// omit the topic string on the wire.
+  bool topic_elided = false;
 };
 
 /// Value type of `node_message`.
@@ -68,7 +125,45 @@ inline bool is_command_message(const node_message& x) {
 template <class Inspector, class PeerId>
 typename Inspector::result_type
 inspect(Inspector& f, generic_node_message<PeerId>& x) {
-  return f(x.content, x.ttl, x.receivers);
+  using result_type = typename Inspector::result_type;
+  if constexpr (std::is_same<result_type, void>::value) {
+    // Inspectors without error handling only render the message.
+    return f(x.content, x.ttl, x.flags, x.receivers, x.origin, x.epoch,
+             x.seq, x.topic_id);
+  } else {
+    if (auto err = f(x.ttl, x.flags, x.receivers, x.origin, x.epoch, x.seq,
+                     x.topic_id, x.topic_elided))
+      return err;
+    if (!x.topic_elided)
+      return f(x.content);
+    // The receiver knows the topic already: only ship the payload. Reading
+    // inspectors never modify the payload.
+    uint8_t tag = 0;
+    if constexpr (Inspector::reads_state) {
+      if (caf::holds_alternative<data_message>(x.content)) {
+        auto& dm = caf::get<data_message>(x.content);
+        return f(tag, const_cast<data&>(get<1>(dm)));
+      }
+      tag = 1;
+      auto& cm = caf::get<command_message>(x.content);
+      return f(tag, const_cast<internal_command&>(get<1>(cm)));
+    } else {
+      if (auto err = f(tag))
+        return err;
+      if (tag == 0) {
+        data d;
+        if (auto err = f(d))
+          return err;
+        x.content = data_message{topic{}, std::move(d)};
+      } else {
+        internal_command cmd;
+        if (auto err = f(cmd))
+          return err;
+        x.content = command_message{topic{}, std::move(cmd)};
+      }
+      return result_type{};
+    }
+  }
 }
 
 /// Generates a ::data_message.
@@ -88,7 +183,21 @@ template <class Value>
 node_message
 make_node_message(Value value, uint16_t ttl,
                   typename node_message::receiver_list receivers = {}) {
-  return {std::move(value), ttl, std::move(receivers)};
+  return {std::move(value), ttl, node_message_flags::none,
+          std::move(receivers)};
+}
+
+/// Generates a ::node_message with routing flags.
+template <class Value>
+node_message make_node_message(Value value, uint16_t ttl,
+                               node_message_flags flags) {
+  return {std::move(value), ttl, flags};
+}
+
+/// Returns whether receivers may forward `x` to other peers.
+template <class PeerId>
+bool is_forwardable(const generic_node_message<PeerId>& x) {
+  return !has_node_message_flags(x.flags, node_message_flags::no_forward);
 }
 
 /// Retrieves the topic from a ::data_message.
@@ -77,8 +77,9 @@ public:
     BROKER_ASSERT(ptr != nullptr);
     BROKER_INFO("spawning new master:" << name);
     auto self = super::self();
-    auto ms = self->template spawn<spawn_flags>(detail::master_actor, self,
-                                                name, std::move(ptr), clock_);
+    auto ms = self->template spawn<spawn_flags>(
+      detail::master_actor, self, name, std::move(ptr), clock_,
+      dref().options().store_change_log_size);
     filter_type filter{name / topics::master_suffix};
     if (auto err = dref().add_store(ms, filter))
       return err;
@@ -121,9 +122,10 @@ public:
   }
 
   /// Instructs the master of the given store to generate a snapshot.
-  void snapshot(const std::string& name, caf::actor& clone) {
+  /// @param seq The last sequence number that the clone has applied.
+  void snapshot(const std::string& name, caf::actor& clone, uint64_t seq) {
     auto msg = make_internal_command<snapshot_command>(super::self(),
-                                                       std::move(clone));
+                                                       std::move(clone), seq);
     dref().publish(make_command_message(name / topics::master_suffix, msg));
   }
 
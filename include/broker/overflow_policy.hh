@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace broker {
+
+/// Selects how a subscriber handles messages that arrive while its queue is
+/// full.
+enum class overflow_policy : uint8_t {
+  /// Stops granting credit to the core until the user catches up. Throttles
+  /// all other receivers of the core's broadcast.
+  block,
+  /// Discards the oldest buffered messages to make room for new ones.
+  drop_oldest,
+  /// Discards new messages.
+  drop_newest,
+  /// Keeps an evenly spaced subset of new messages that fits into the queue.
+  sample,
+};
+
+} // namespace broker
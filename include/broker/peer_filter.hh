@@ -20,6 +20,17 @@ struct peer_filter_matcher {
     detail::prefix_matcher g;
     return f.first != active_sender && g(f.second, x);
   }
+
+  /// Returns the subscriptions in `f`.
+  const std::vector<topic>& topics(const peer_filter& f) const noexcept {
+    return f.second;
+  }
+
+  /// Returns whether the peer with filter `f` may receive messages from the
+  /// currently active sender.
+  bool accepts(const peer_filter& f) const noexcept {
+    return f.first != active_sender;
+  }
 };
 
 } // namespace broker
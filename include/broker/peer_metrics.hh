@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace broker {
+
+/// A snapshot of the counters for the traffic between an endpoint and its
+/// peers.
+/// @relates endpoint
+struct peer_metrics {
+  /// Number of messages that arrived via multiple paths or loops and that the
+  /// endpoint dropped as duplicates.
+  uint64_t duplicates = 0;
+
+  /// Number of bytes that the endpoint buffers in memory for blocked peers,
+  /// measured in serialized form.
+  uint64_t blocked_bytes = 0;
+
+  /// Number of bytes that the endpoint buffers on disk for blocked peers.
+  uint64_t spilled_bytes = 0;
+};
+
+/// @relates peer_metrics
+std::string to_string(const peer_metrics& x);
+
+} // namespace broker
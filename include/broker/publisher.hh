@@ -9,6 +9,7 @@
 #include "broker/atoms.hh"
 #include "broker/fwd.hh"
 #include "broker/message.hh"
+#include "broker/queue_metrics.hh"
 
 #include "broker/detail/shared_publisher_queue.hh"
 
@@ -49,17 +50,26 @@ public:
   /// Returns the current size of the output queue.
   size_t buffered() const;
 
-  /// Returns the capacity of the output queue.
+  /// Returns the capacity of the output queue. The capacity may grow up to
+  /// `max_capacity()` while the core keeps draining the queue completely.
   size_t capacity() const;
 
+  /// Returns the upper bound for the capacity of the output queue.
+  size_t max_capacity() const;
+
   /// Returns the free capacity of the output queue, i.e., how many items can
   /// be enqueued before it starts blocking. The free capacity is calculated as
   /// `capacity - buffered`.
   size_t free_capacity() const;
 
-  /// Returns a rough estimate of the throughput per second of this publisher.
+  /// Returns the number of messages per second that this publisher sends to
+  /// the core, averaged over the time since the previous call (at least one
+  /// second ago).
   size_t send_rate() const;
 
+  /// Returns the counters and latency percentiles of the output queue.
+  queue_metrics metrics() const;
+
   /// Returns a reference to the background worker.
   const caf::actor& worker() const {
     return worker_;
@@ -87,7 +97,10 @@ public:
 
 private:
   // -- force users to use `endpoint::make_publsiher` -------------------------
-  publisher(endpoint& ep, topic t);
+  publisher(endpoint& ep, topic t, size_t capacity, size_t max_capacity);
+
+  /// Sends a resume message to the worker unless one is already in flight.
+  void wake_worker();
 
   bool drop_on_destruction_;
   detail::shared_publisher_queue_ptr<> queue_;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace broker {
+
+/// Selects the queue that connects a subscriber to its background worker.
+enum class queue_kind : uint8_t {
+  locked,    ///< A double-ended queue guarded by a mutex.
+  lock_free, ///< A lock-free single-producer, single-consumer queue.
+};
+
+} // namespace broker
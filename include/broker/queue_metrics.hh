@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "broker/time.hh"
+
+namespace broker {
+
+/// A snapshot of the counters for the queue of a publisher or subscriber.
+/// @relates endpoint
+struct queue_metrics {
+  /// Identifies the queue, e.g., `publisher /foo/bar`.
+  std::string name;
+
+  /// Number of items that entered the queue.
+  uint64_t enqueued = 0;
+
+  /// Number of items that left the queue.
+  uint64_t dequeued = 0;
+
+  /// Number of items that the queue discarded due to an overflow policy.
+  uint64_t dropped = 0;
+
+  /// Number of items in the queue.
+  uint64_t buffered = 0;
+
+  /// Median of the time items spent in the queue.
+  timespan latency_p50{0};
+
+  /// 90th percentile of the time items spent in the queue.
+  timespan latency_p90{0};
+
+  /// 99th percentile of the time items spent in the queue.
+  timespan latency_p99{0};
+
+  /// Maximum time an item spent in the queue.
+  timespan latency_max{0};
+};
+
+/// @relates queue_metrics
+std::string to_string(const queue_metrics& x);
+
+} // namespace broker
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <caf/actor.hpp>
+
+#include "broker/fwd.hh"
+#include "broker/message.hh"
+#include "broker/overflow_policy.hh"
+#include "broker/queue_kind.hh"
+#include "broker/queue_metrics.hh"
+#include "broker/subscriber_base.hh"
+#include "broker/topic.hh"
+
+#include "broker/detail/subscriber_worker.hh"
+
+namespace broker {
+
+/// Provides blocking access to a stream of data that is split into multiple
+/// shards. Each shard has its own queue and file handle, i.e., users can
+/// consume the shards on separate threads without contention. A shard
+/// function routes each message to a shard based on its topic, so all
+/// messages for a topic arrive at the same shard in order.
+class sharded_subscriber {
+public:
+  // --- friend declarations ---------------------------------------------------
+
+  friend class endpoint;
+
+  // --- nested types ----------------------------------------------------------
+
+  /// Maps a topic to a shard. The subscriber reduces the result modulo the
+  /// number of shards.
+  using shard_function = detail::shard_function;
+
+  /// Provides blocking access to the messages of a single shard.
+  class shard : public subscriber_base<data_message> {
+  public:
+    friend class endpoint;
+    friend class sharded_subscriber;
+
+    using super = subscriber_base<data_message>;
+
+    shard(size_t max_qsize, queue_kind kind);
+
+    shard(shard&&) = default;
+
+    shard& operator=(shard&&) = default;
+
+    /// Returns the number of messages that this shard discarded due to the
+    /// overflow policy.
+    size_t dropped() const;
+
+    /// Returns the counters and latency percentiles of the queue.
+    queue_metrics metrics() const;
+
+  protected:
+    void became_not_full() override;
+
+  private:
+    caf::actor worker_;
+  };
+
+  // --- constructors and destructors ------------------------------------------
+
+  sharded_subscriber(sharded_subscriber&&) = default;
+
+  sharded_subscriber& operator=(sharded_subscriber&&) = default;
+
+  ~sharded_subscriber();
+
+  // --- properties ------------------------------------------------------------
+
+  /// Returns the number of shards.
+  size_t size() const noexcept {
+    return shards_.size();
+  }
+
+  /// Returns the shard at index `i`.
+  shard& operator[](size_t i) {
+    return shards_[i];
+  }
+
+  /// Returns the shard at index `i`.
+  const shard& operator[](size_t i) const {
+    return shards_[i];
+  }
+
+  /// Returns the rate of all shards combined.
+  /// @copydetails subscriber::rate
+  size_t rate() const;
+
+  const caf::actor& worker() const {
+    return worker_;
+  }
+
+private:
+  // -- force users to use `endpoint::make_sharded_subscriber` -----------------
+  sharded_subscriber(endpoint& ep, std::vector<topic> ts, size_t num_shards,
+                     shard_function f, size_t max_qsize, queue_kind kind,
+                     overflow_policy policy);
+
+  std::vector<shard> shards_;
+  caf::actor worker_;
+};
+
+} // namespace broker
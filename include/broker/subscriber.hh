@@ -8,6 +8,9 @@
 #include "broker/data.hh"
 #include "broker/fwd.hh"
 #include "broker/message.hh"
+#include "broker/overflow_policy.hh"
+#include "broker/queue_kind.hh"
+#include "broker/queue_metrics.hh"
 #include "broker/subscriber_base.hh"
 #include "broker/topic.hh"
 
@@ -37,11 +40,29 @@ public:
 
   // --- properties ------------------------------------------------------------
 
-  /// Enables or disables rate calculation. On by default.
+  /// Has no effect, since computing the rate no longer requires a timer in
+  /// the background worker.
+  /// @deprecated
   void set_rate_calculation(bool x);
 
+  /// Returns the number of messages per second that arrive at this
+  /// subscriber, averaged over the time since the previous call (at least one
+  /// second ago).
   size_t rate() const;
 
+  /// Returns the counters and latency percentiles of the queue.
+  queue_metrics metrics() const;
+
+  /// Returns how this subscriber handles messages that arrive while its queue
+  /// is full.
+  overflow_policy policy() const {
+    return policy_;
+  }
+
+  /// Returns the number of messages that this subscriber discarded due to its
+  /// overflow policy.
+  size_t dropped() const;
+
   const caf::actor& worker() const {
     return worker_;
   }
@@ -57,8 +78,10 @@ protected:
 
 private:
   // -- force users to use `endpoint::make_status_subscriber` ------------------
-  subscriber(endpoint& ep, std::vector<topic> ts, size_t max_qsize);
+  subscriber(endpoint& ep, std::vector<topic> ts, size_t max_qsize,
+             queue_kind kind, overflow_policy policy);
 
+  overflow_policy policy_;
   caf::actor worker_;
   std::vector<topic> filter_;
   std::reference_wrapper<endpoint> ep_;
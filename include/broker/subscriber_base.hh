@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 
 #include <caf/actor.hpp>
@@ -8,9 +10,12 @@
 
 #include "broker/data.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/cpu_relax.hh"
 #include "broker/detail/shared_subscriber_queue.hh"
 #include "broker/fwd.hh"
 #include "broker/logger.hh"
+#include "broker/queue_kind.hh"
+#include "broker/time.hh"
 #include "broker/topic.hh"
 
 namespace broker {
@@ -29,8 +34,8 @@ public:
 
   // --- constructors and destructors ------------------------------------------
 
-  subscriber_base(long max_qsize)
-    : queue_(detail::make_shared_subscriber_queue<value_type>()),
+  subscriber_base(long max_qsize, queue_kind kind = queue_kind::locked)
+    : queue_(detail::make_shared_subscriber_queue<value_type>(kind)),
       max_qsize_(max_qsize) {
     // nop
   }
@@ -52,11 +57,11 @@ public:
   /// Pulls a single value out of the stream. Blocks the current thread until
   /// at least one value becomes available.
   value_type get() {
-    auto tmp = get(1);
-    BROKER_ASSERT(tmp.size() == 1);
-    auto x = std::move(tmp.front());
-    BROKER_DEBUG("received" << x);
-    return x;
+    caf::optional<value_type> result;
+    auto f = [&result](value_type&& x) { result = std::move(x); };
+    fetch(1, f);
+    BROKER_ASSERT(result);
+    return std::move(*result);
   }
 
   /// Pulls a single value out of the stream. Blocks the current thread until
@@ -64,13 +69,10 @@ public:
   template <class Timeout,
             class = std::enable_if_t<!std::is_integral<Timeout>::value>>
   caf::optional<value_type> get(Timeout timeout) {
-    auto tmp = get(1, timeout);
-    if (tmp.size() == 1) {
-      auto x = std::move(tmp.front());
-      BROKER_DEBUG("received" << x);
-      return caf::optional<value_type>(std::move(x));
-    }
-    return caf::none;
+    caf::optional<value_type> result;
+    auto f = [&result](value_type&& x) { result = std::move(x); };
+    fetch_until(1, timeout, f);
+    return result;
   }
 
   /// Pulls `num` values out of the stream. Blocks the current thread until
@@ -81,26 +83,9 @@ public:
   std::vector<value_type>
   get(size_t num, std::chrono::time_point<Clock, Duration> timeout) {
     std::vector<value_type> result;
-    if (num == 0)
-      return result;
-    if (timeout <= std::chrono::system_clock::now())
-      return result;
     result.reserve(num);
-    for (;;) {
-      if (!queue_->wait_on_flare_abs(timeout))
-        return result;
-      size_t prev_size = 0;
-      auto remaining = num - result.size();
-      auto got = queue_->consume(remaining, &prev_size, [&](value_type&& x) {
-        BROKER_DEBUG("received" << x);
-        result.emplace_back(std::move(x));
-      });
-      if (prev_size >= static_cast<size_t>(max_qsize_)
-          && prev_size - got < static_cast<size_t>(max_qsize_))
-        became_not_full();
-      if (result.size() == num)
-        return result;
-    }
+    get_into(result, num, timeout);
+    return result;
   }
 
   /// Pulls `num` values out of the stream. Blocks the current thread until
@@ -109,45 +94,74 @@ public:
   /// `num` elements.
   template <class Duration>
   std::vector<value_type> get(size_t num, Duration relative_timeout) {
-    if (!caf::is_infinite(relative_timeout)) {
-      auto timeout = caf::make_timestamp();
-      timeout += relative_timeout;
-      return get(num, timeout);
-    }
     std::vector<value_type> result;
-    if (num == 0)
-      return result;
     result.reserve(num);
-    for (;;) {
-      queue_->wait_on_flare();
-      size_t prev_size = 0;
-      auto remaining = num - result.size();
-      auto got = queue_->consume(remaining, &prev_size, [&](value_type&& x) {
-        BROKER_DEBUG("received" << x);
-        result.emplace_back(std::move(x));
-      });
-      if (prev_size >= static_cast<size_t>(max_qsize_)
-          && prev_size - got < static_cast<size_t>(max_qsize_))
-        became_not_full();
-      if (result.size() == num)
-        return result;
-    }
+    get_into(result, num, relative_timeout);
+    return result;
   }
 
   std::vector<value_type> get(size_t num) {
     return get(num, caf::infinite);
   }
 
+  /// Moves up to `num` values out of the stream and appends them to `out`.
+  /// Blocks the current thread until `num` elements are available or a
+  /// timeout occurs. Unlike `get`, this function never allocates memory as
+  /// long as `out` has sufficient capacity, i.e., callers can reuse the same
+  /// buffer across calls.
+  /// @param timeout Either an absolute or a relative timeout.
+  /// @returns The number of values added to `out`.
+  template <class Timeout>
+  size_t get_into(std::vector<value_type>& out, size_t num, Timeout timeout) {
+    auto f = [&out](value_type&& x) { out.emplace_back(std::move(x)); };
+    return fetch_until(num, timeout, f);
+  }
+
+  /// Moves `num` values out of the stream and appends them to `out`. Blocks
+  /// the current thread until `num` elements are available.
+  /// @returns The number of values added to `out`, i.e., `num`.
+  size_t get_into(std::vector<value_type>& out, size_t num) {
+    return get_into(out, num, caf::infinite);
+  }
+
   /// Returns all currently available values without blocking.
   std::vector<value_type> poll() {
-    auto rval = queue_->consume_all();
-    if (rval.size() >= static_cast<size_t>(max_qsize_))
+    std::vector<value_type> result;
+    poll_into(result);
+    return result;
+  }
+
+  /// Appends all currently available values to `out` without blocking.
+  /// @returns The number of values added to `out`.
+  size_t poll_into(std::vector<value_type>& out) {
+    return consume([&out](value_type&& x) { out.emplace_back(std::move(x)); });
+  }
+
+  /// Passes all currently available values to `f` without blocking.
+  /// @returns The number of consumed values.
+  template <class F>
+  size_t consume(F f) {
+    auto n = queue_->consume_all(f);
+    if (n >= static_cast<size_t>(max_qsize_))
       became_not_full();
-    return rval;
+    return n;
   }
 
   // --- accessors -------------------------------------------------------------
 
+  /// Returns how long `get` may poll the queue before blocking.
+  timespan spin_budget() const noexcept {
+    return spin_budget_;
+  }
+
+  /// Allows `get` to poll the queue for up to `x` before blocking on the
+  /// file handle. Spinning trades CPU time for latency when values arrive in
+  /// quick succession. A budget of zero (the default) disables spinning.
+  void spin_budget(timespan x) noexcept {
+    spin_budget_ = std::max(x, timespan{0});
+    spin_limit_ = spin_budget_;
+  }
+
   /// Returns the amound of values than can be extracted immediately without
   /// blocking.
   size_t available() const {
@@ -170,6 +184,102 @@ protected:
 
   queue_ptr queue_;
   long max_qsize_;
+
+private:
+  template <class Clock, class Duration, class F>
+  size_t fetch_until(size_t num,
+                     std::chrono::time_point<Clock, Duration> timeout, F& f) {
+    return fetch(num, timeout, f);
+  }
+
+  template <class Duration, class F>
+  size_t fetch_until(size_t num, Duration relative_timeout, F& f) {
+    if (caf::is_infinite(relative_timeout))
+      return fetch(num, f);
+    auto timeout = caf::make_timestamp();
+    timeout += relative_timeout;
+    return fetch(num, timeout, f);
+  }
+
+  /// Passes up to `num` values from the queue to `f`, calling
+  /// `became_not_full` if the queue drops below its maximum size.
+  template <class F>
+  size_t fetch_some(size_t num, F& f) {
+    size_t prev_size = 0;
+    auto got = queue_->consume(num, &prev_size, [&f](value_type&& x) {
+      BROKER_DEBUG("received" << x);
+      f(std::move(x));
+    });
+    if (prev_size >= static_cast<size_t>(max_qsize_)
+        && prev_size - got < static_cast<size_t>(max_qsize_))
+      became_not_full();
+    return got;
+  }
+
+  /// Passes `num` values from the queue to `f`, blocking until `num` values
+  /// were available or reaching `timeout`.
+  template <class Clock, class Duration, class F>
+  size_t fetch(size_t num, std::chrono::time_point<Clock, Duration> timeout,
+               F& f) {
+    size_t result = 0;
+    if (num == 0)
+      return result;
+    if (timeout <= std::chrono::system_clock::now())
+      return result;
+    for (;;) {
+      auto left = std::chrono::duration_cast<timespan>(timeout - Clock::now());
+      if (!spin(std::min(spin_limit_, left))
+          && !queue_->wait_on_flare_abs(timeout))
+        return result;
+      result += fetch_some(num - result, f);
+      if (result == num)
+        return result;
+    }
+  }
+
+  /// Passes `num` values from the queue to `f`, blocking until `num` values
+  /// were available.
+  template <class F>
+  size_t fetch(size_t num, F& f) {
+    size_t result = 0;
+    if (num == 0)
+      return result;
+    for (;;) {
+      if (!spin(spin_limit_))
+        queue_->wait_on_flare();
+      result += fetch_some(num - result, f);
+      if (result == num)
+        return result;
+    }
+  }
+
+  /// Polls the queue for up to `limit`. Adapts `spin_limit_` to the arrival
+  /// pattern: doubles it after finding values, up to `spin_budget_`, and halves
+  /// it after each unsuccessful round, down to 1/16 of `spin_budget_`.
+  /// @returns `true` if the queue has values, `false` otherwise.
+  bool spin(timespan limit) {
+    if (limit.count() <= 0)
+      return false;
+    using spin_clock = std::chrono::steady_clock;
+    auto deadline = spin_clock::now() + limit;
+    for (size_t i = 1;; ++i) {
+      if (queue_->buffer_size() > 0) {
+        spin_limit_ = std::min(spin_limit_ * 2, spin_budget_);
+        return true;
+      }
+      detail::cpu_relax();
+      if (i % 64 == 0 && spin_clock::now() >= deadline) {
+        spin_limit_ = std::max(spin_limit_ / 2, spin_budget_ / 16);
+        return false;
+      }
+    }
+  }
+
+  /// Maximum time for polling the queue in `get`.
+  timespan spin_budget_{0};
+
+  /// Current time for polling the queue in `get`.
+  timespan spin_limit_{0};
 };
 
 } // namespace broker
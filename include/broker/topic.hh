@@ -1,12 +1,14 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "broker/detail/operators.hh"
+#include "broker/detail/topic_intern_table.hh"
 
 namespace broker {
 
@@ -55,13 +57,41 @@ public:
   /// Returns whether this topic is a prefix match for `t`.
   bool prefix_of(const topic& t) const;
 
+  /// Replaces the string of this topic with a reference into the process-wide
+  /// intern table. Copying, comparing, and hashing interned topics no longer
+  /// touches the string. Interned topics still serialize as regular strings.
+  /// @returns `true` if the topic is interned after the call, `false` if the
+  ///          intern table is full.
+  bool intern();
+
+  /// Returns the process-local ID of an interned topic or 0 if this topic is
+  /// not interned.
+  uint32_t id() const noexcept {
+    return entry_ != nullptr ? entry_->id : 0;
+  }
+
+  /// Returns a hash value for this topic that does not depend on whether this
+  /// topic is interned.
+  size_t hash() const noexcept;
+
   template <class Inspector>
   friend typename Inspector::result_type inspect(Inspector& f, topic& t) {
-    return f(t.str_);
+    if constexpr (Inspector::reads_state) {
+      // Interned topics go over the wire as regular strings. Reading
+      // inspectors never modify the string.
+      return f(const_cast<std::string&>(t.string()));
+    } else {
+      t.entry_ = nullptr;
+      return f(t.str_);
+    }
   }
 
 private:
+  /// Stores the topic string unless the topic is interned.
   std::string str_;
+
+  /// Points to the intern table entry of this topic (if interned).
+  const detail::interned_topic* entry_ = nullptr;
 };
 
 /// @relates topic
@@ -106,7 +136,7 @@ namespace std {
 template <>
 struct hash<broker::topic> {
   size_t operator()(const broker::topic& t) const {
-    return std::hash<std::string>{}(t.string());
+    return t.hash();
   }
 };
 
@@ -119,6 +119,22 @@ configuration::configuration(skip_init_t) {
     .add(options_.disable_ssl, "disable_ssl",
          "forces Broker to use unencrypted communication")
     .add(options_.ttl, "ttl", "drop messages after traversing TTL hops")
+    .add(options_.source_routing, "source_routing",
+         "attach receiver lists to forwarded messages")
+    .add(options_.dedup_window, "dedup_window",
+         "number of recent messages per origin for detecting duplicates")
+    .add(options_.blocked_peer_max_bytes, "blocked_peer_max_bytes",
+         "maximum number of buffered bytes per blocked peer")
+    .add(options_.blocked_peer_max_messages, "blocked_peer_max_messages",
+         "maximum number of buffered messages per blocked peer")
+    .add(options_.blocked_peer_spill_directory, "blocked_peer_spill_directory",
+         "path for buffering messages of blocked peers on disk")
+    .add(options_.publisher_queue_size, "publisher_queue_size",
+         "number of buffered messages per publisher")
+    .add(options_.publisher_queue_max_size, "publisher_queue_max_size",
+         "upper bound for growing the buffer of publishers")
+    .add(options_.store_change_log_size, "store_change_log_size",
+         "number of recent changes that masters keep for clones")
     .add<std::string>("recording-directory",
                       "path for storing recorded meta information")
     .add<size_t>("output-generator-file-cap",
@@ -241,6 +257,18 @@ caf::settings configuration::dump_content() const {
   put_missing(grp, "disable_ssl", options_.disable_ssl);
   put_missing(grp, "ttl", options_.ttl);
   put_missing(grp, "forward", options_.forward);
+  put_missing(grp, "source_routing", options_.source_routing);
+  put_missing(grp, "dedup_window", options_.dedup_window);
+  put_missing(grp, "blocked_peer_max_bytes", options_.blocked_peer_max_bytes);
+  put_missing(grp, "blocked_peer_max_messages",
+              options_.blocked_peer_max_messages);
+  if (!options_.blocked_peer_spill_directory.empty())
+    put_missing(grp, "blocked_peer_spill_directory",
+                options_.blocked_peer_spill_directory);
+  put_missing(grp, "publisher_queue_size", options_.publisher_queue_size);
+  put_missing(grp, "publisher_queue_max_size",
+              options_.publisher_queue_max_size);
+  put_missing(grp, "store_change_log_size", options_.store_change_log_size);
   if (auto path = get_if<std::string>(&content, "broker.recording-directory"))
     put_missing(grp, "recording-directory", *path);
   if (auto cap = get_if<size_t>(&content, "broker.output-generator-file-cap"))
@@ -27,7 +27,9 @@
 #include "broker/convert.hh"
 #include "broker/defaults.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/core_stats.hh"
 #include "broker/detail/filesystem.hh"
+#include "broker/detail/ingress_queue.hh"
 #include "broker/detail/make_backend.hh"
 #include "broker/endpoint.hh"
 #include "broker/error.hh"
@@ -47,6 +49,10 @@ core_manager::core_manager(caf::event_based_actor* ptr,
     options_(opts),
     filter_(initial_filter) {
   cache().set_use_ssl(!options_.disable_ssl);
+  // Receiver lists are opt-in and only serve peers that forward messages.
+  if (options_.forward && options_.source_routing)
+    peer_manager().enable_source_routing(ptr->node());
+  dedup().capacity(options_.dedup_window);
 }
 
 void core_manager::update_filter_on_peers() {
@@ -236,6 +242,18 @@ caf::behavior core_manager::make_behavior(){
       BROKER_TRACE(BROKER_ARG(x));
       publish(std::move(x));
     },
+    [=](atom::publish, command_message& x, node_message_flags flags) {
+      BROKER_TRACE(BROKER_ARG(x) << BROKER_ARG(flags));
+      publish(std::move(x), flags);
+    },
+    [=](atom::publish, detail::ingress_queue_ptr& q) {
+      BROKER_TRACE("");
+      publish_all(q->xs);
+    },
+    [=](atom::metrics, detail::core_stats_ptr& ptr) {
+      BROKER_TRACE("");
+      stats(std::move(ptr));
+    },
     // --- communication to local actors only, i.e., never forward to peers ----
     [=](atom::publish, atom::local, data_message& x) {
       BROKER_TRACE(BROKER_ARG(x));
@@ -9,5 +9,7 @@ const caf::string_view recording_directory = "";
 
 const size_t output_generator_file_cap = std::numeric_limits<size_t>::max();
 
+const size_t store_scan_batch_size = 1024;
+
 } // namespace defaults
 } // namespace broker
@@ -1,9 +1,15 @@
 #include "broker/detail/appliers.hh"
 #include "broker/detail/abstract_backend.hh"
 
+#include "broker/defaults.hh"
+
 namespace broker {
 namespace detail {
 
+backend_cursor::~backend_cursor() {
+  // nop
+}
+
 expected<void> abstract_backend::add(const data& key, const data& value,
                                      data::type init_type,
                                      optional<timestamp> expiry) {
@@ -31,6 +37,14 @@ expected<void> abstract_backend::subtract(const data& key, const data& value,
   return put(key, *v, expiry);
 }
 
+expected<void> abstract_backend::begin_batch() {
+  return {};
+}
+
+expected<void> abstract_backend::commit_batch() {
+  return {};
+}
+
 expected<data> abstract_backend::get(const data& key, const data& value) const {
   auto k = get(key);
   if (!k)
@@ -38,5 +52,33 @@ expected<data> abstract_backend::get(const data& key, const data& value) const {
   return caf::visit(retriever{value}, *k);
 }
 
+expected<data> abstract_backend::keys() const {
+  set result;
+  scan_entries buf;
+  auto cursor = scan();
+  for (;;) {
+    if (auto res = cursor->next(buf, defaults::store_scan_batch_size); !res)
+      return res.error();
+    if (buf.empty())
+      return {std::move(result)};
+    for (auto& x : buf)
+      result.emplace(std::move(x.key));
+  }
+}
+
+expected<snapshot> abstract_backend::snapshot() const {
+  broker::snapshot result;
+  scan_entries buf;
+  auto cursor = scan();
+  for (;;) {
+    if (auto res = cursor->next(buf, defaults::store_scan_batch_size); !res)
+      return res.error();
+    if (buf.empty())
+      return {std::move(result)};
+    for (auto& x : buf)
+      result.emplace(std::move(x.key), std::move(x.value));
+  }
+}
+
 } // namespace detail
 } // namespace broker
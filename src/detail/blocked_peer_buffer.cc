@@ -0,0 +1,127 @@
+#include "broker/detail/blocked_peer_buffer.hh"
+
+#include <cstdio>
+
+#include <caf/actor_system.hpp>
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/detail/serialized_size.hpp>
+#include <caf/error.hpp>
+#include <caf/none.hpp>
+
+#include "broker/error.hh"
+#include "broker/logger.hh"
+
+namespace broker {
+namespace detail {
+
+blocked_peer_buffer::blocked_peer_buffer(caf::actor_system& sys,
+                                         size_t max_bytes, size_t max_messages,
+                                         std::string spill_file)
+  : sys_(sys),
+    max_bytes_(max_bytes),
+    max_messages_(max_messages),
+    spill_file_(std::move(spill_file)) {
+  // nop
+}
+
+blocked_peer_buffer::~blocked_peer_buffer() {
+  reset();
+}
+
+caf::error blocked_peer_buffer::push(caf::message batch,
+                                     size_t num_messages) {
+  if (full() && spilling()) {
+    size_t num_bytes = 0;
+    if (auto err = spill(batch, num_bytes))
+      return err;
+    spilled_bytes_ += num_bytes;
+    spilled_messages_ += num_messages;
+    return caf::none;
+  }
+  buffered_bytes_ += caf::detail::serialized_size(sys_, batch);
+  buffered_messages_ += num_messages;
+  batches_.emplace_back(std::move(batch));
+  return caf::none;
+}
+
+caf::error blocked_peer_buffer::drain(consumer f) {
+  for (auto& batch : batches_)
+    f(batch);
+  if (!out_.is_open()) {
+    reset();
+    return caf::none;
+  }
+  out_.close();
+  std::ifstream in{spill_file_, std::ifstream::binary};
+  auto fail = [this](ec code) {
+    auto err = make_error(code, spill_file_);
+    reset();
+    return err;
+  };
+  if (!in.is_open())
+    return fail(ec::cannot_open_file);
+  uint32_t magic = 0;
+  uint8_t version = 0;
+  if (!in.read(reinterpret_cast<char*>(&magic), sizeof(magic))
+      || !in.read(reinterpret_cast<char*>(&version), sizeof(version))
+      || magic != format::magic || version != format::version)
+    return fail(ec::invalid_data);
+  auto& bytes = spill_buf_;
+  uint32_t size = 0;
+  while (in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+    bytes.resize(size);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), size))
+      return fail(ec::end_of_file);
+    caf::message batch;
+    caf::binary_deserializer source{sys_, bytes};
+    if (auto err = source(batch)) {
+      reset();
+      return err;
+    }
+    f(batch);
+  }
+  reset();
+  return caf::none;
+}
+
+caf::error blocked_peer_buffer::spill(const caf::message& batch,
+                                      size_t& num_bytes) {
+  if (!out_.is_open()) {
+    out_.open(spill_file_, std::ofstream::binary | std::ofstream::trunc);
+    if (!out_.is_open())
+      return make_error(ec::cannot_open_file, spill_file_);
+    auto magic = format::magic;
+    auto version = format::version;
+    out_.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    out_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    BROKER_DEBUG("started spilling batches to" << spill_file_);
+  }
+  auto& bytes = spill_buf_;
+  bytes.clear();
+  caf::binary_serializer sink{sys_, bytes};
+  if (auto err = sink(batch))
+    return err;
+  auto size = static_cast<uint32_t>(bytes.size());
+  out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out_.write(reinterpret_cast<const char*>(bytes.data()), size);
+  num_bytes = bytes.size();
+  if (!out_)
+    return make_error(ec::cannot_write_file, spill_file_);
+  return caf::none;
+}
+
+void blocked_peer_buffer::reset() {
+  batches_.clear();
+  buffered_bytes_ = 0;
+  buffered_messages_ = 0;
+  spilled_bytes_ = 0;
+  spilled_messages_ = 0;
+  if (out_.is_open())
+    out_.close();
+  if (spilling())
+    std::remove(spill_file_.c_str());
+}
+
+} // namespace detail
+} // namespace broker
@@ -21,6 +21,7 @@
 
 #include "broker/detail/appliers.hh"
 #include "broker/detail/clone_actor.hh"
+#include "broker/detail/diff_snapshots.hh"
 
 #include <chrono>
 
@@ -36,6 +37,7 @@ void clone_state::init(caf::event_based_actor* ptr, std::string&& nm,
                        caf::actor&& parent, endpoint::clock* ep_clock) {
   super::init(ptr, ep_clock, std::move(nm), std::move(parent));
   master_topic = id / topics::master_suffix;
+  master_topic.intern();
 }
 
 void clone_state::forward(internal_command&& x) {
@@ -49,6 +51,8 @@ void clone_state::command(internal_command::variant_type& cmd) {
 
 void clone_state::command(internal_command& cmd) {
   command(cmd.content);
+  if (cmd.seq > 0)
+    seq = cmd.seq;
 }
 
 void clone_state::operator()(none) {
@@ -74,14 +78,20 @@ void clone_state::operator()(put_unique_command& x) {
 
 void clone_state::operator()(erase_command& x) {
   BROKER_INFO("ERASE" << x.key);
-  if (store.erase(x.key) != 0)
+  if (auto i = store.find(x.key); i != store.end()) {
+    snapshot_stale_keys.erase(&i->first);
+    store.erase(i);
     emit_erase_event(x.key, x.publisher);
+  }
 }
 
 void clone_state::operator()(expire_command& x) {
   BROKER_INFO("EXPIRE" << x.key);
-  if (store.erase(x.key) != 0)
+  if (auto i = store.find(x.key); i != store.end()) {
+    snapshot_stale_keys.erase(&i->first);
+    store.erase(i);
     emit_expire_event(x.key, x.publisher);
+  }
 }
 
 void clone_state::operator()(add_command&) {
@@ -97,8 +107,13 @@ void clone_state::operator()(snapshot_command&) {
 }
 
 void clone_state::operator()(snapshot_sync_command& x) {
-  if (x.remote_clone == self)
+  if (x.remote_clone == self) {
     awaiting_snapshot_sync = false;
+    // If the snapshot arrived first, the clone now has the state of the
+    // master at the sync point.
+    if (!awaiting_snapshot)
+      seq = sync_seq;
+  }
 }
 
 void clone_state::operator()(set_command& x) {
@@ -113,36 +128,17 @@ void clone_state::operator()(set_command& x) {
     }
     return;
   }
-  if (store.empty()) {
-    // Emit insert events.
-    for (auto& [key, value] : x.state)
+  diff_snapshots(
+    store, x.state,
+    [&](const data& key) { emit_erase_event(key, publisher_id{}); },
+    [&](const data& key, const data& old_value, const data& new_value) {
+      emit_update_event(key, old_value, new_value, nil, publisher);
+    },
+    [&](const data& key, const data& value) {
       emit_insert_event(key, value, nil, publisher);
-  } else {
-    // Emit erase and put events.
-    std::vector<const data*> keys;
-    keys.reserve(store.size());
-    for (auto& kvp : store)
-      keys.emplace_back(&kvp.first);
-    auto is_erased = [&x](const data* key) { return x.state.count(*key) == 0; };
-    auto p = std::partition(keys.begin(), keys.end(), is_erased);
-    for (auto i = keys.begin(); i != p; ++i)
-      emit_erase_event(**i, publisher_id{});
-    for (auto i = p; i != keys.end(); ++i) {
-      const auto& value = x.state[**i];
-      emit_update_event(**i, store[**i], value, nil, publisher);
-    }
-    // Emit insert events.
-    auto is_new = [&keys](const data& key) {
-      for (const auto key_ptr : keys)
-        if (*key_ptr == key)
-          return false;
-      return true;
-    };
-    for (const auto& [key, value] : x.state)
-      if (is_new(key))
-        emit_insert_event(key, value, nil, publisher);
-  }
+    });
   // Override local state.
+  snapshot_stale_keys.clear();
   store = std::move(x.state);
 }
 
@@ -150,9 +146,63 @@ void clone_state::operator()(clear_command& x) {
   BROKER_INFO("CLEAR");
   for (auto& kvp : store)
     emit_erase_event(kvp.first, x.publisher);
+  snapshot_stale_keys.clear();
   store.clear();
 }
 
+void clone_state::start_snapshot() {
+  BROKER_INFO("START SNAPSHOT");
+  // The store no longer matches any sequence number until the snapshot is
+  // complete.
+  seq = 0;
+  snapshot_stale_keys.clear();
+  snapshot_stale_keys.reserve(store.size());
+  for (auto& kvp : store)
+    snapshot_stale_keys.emplace(&kvp.first);
+}
+
+void clone_state::apply_snapshot_entry(snapshot_entry& x) {
+  // We consider the master the source of all updates.
+  publisher_id publisher{master.node(), master.id()};
+  if (auto i = store.find(x.key); i != store.end()) {
+    snapshot_stale_keys.erase(&i->first);
+    emit_update_event(x.key, i->second, x.value, nil, publisher);
+    i->second = std::move(x.value);
+  } else {
+    emit_insert_event(x.key, x.value, nil, publisher);
+    store.emplace(std::move(x.key), std::move(x.value));
+  }
+}
+
+void clone_state::finish_snapshot() {
+  BROKER_INFO("FINISH SNAPSHOT, erasing" << snapshot_stale_keys.size()
+                                         << "stale keys");
+  for (auto key : snapshot_stale_keys) {
+    emit_erase_event(*key, publisher_id{});
+    store.erase(store.find(*key));
+  }
+  snapshot_stale_keys.clear();
+  snapshot_complete();
+}
+
+void clone_state::apply_delta(snapshot_delta& x) {
+  BROKER_INFO("DELTA with" << x.commands.size() << "commands");
+  for (auto& cmd : x.commands)
+    command(cmd);
+  snapshot_complete();
+}
+
+void clone_state::snapshot_complete() {
+  awaiting_snapshot = false;
+  if (!awaiting_snapshot_sync) {
+    seq = sync_seq;
+    for (auto& update : pending_remote_updates)
+      command(update);
+    pending_remote_updates.clear();
+    pending_remote_updates.shrink_to_fit();
+  }
+}
+
 data clone_state::keys() const {
   set result;
   for (auto& kvp : store)
@@ -236,15 +286,10 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
     },
     [=](set_command& x) {
       self->state(x);
-      self->state.awaiting_snapshot = false;
-
-      if ( ! self->state.awaiting_snapshot_sync ) {
-        for ( auto& update : self->state.pending_remote_updates )
-          self->state.command(update);
-
-        self->state.pending_remote_updates.clear();
-        self->state.pending_remote_updates.shrink_to_fit();
-      }
+      self->state.snapshot_complete();
+    },
+    [=](snapshot_delta& x) {
+      self->state.apply_delta(x);
     },
     [=](atom::sync_point, caf::actor& who) {
       self->send(who, atom::sync_point_v);
@@ -266,6 +311,11 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
         return;
 
       BROKER_INFO("resolved master");
+      // Sequence numbers only remain valid while talking to the same master.
+      if (master.address() != self->state.seq_source) {
+        self->state.seq = 0;
+        self->state.seq_source = master.address();
+      }
       self->state.master = std::move(master);
       self->state.is_stale = false;
       self->state.stale_time = -1.0;
@@ -279,7 +329,7 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
       self->state.mutation_buffer.shrink_to_fit();
 
       self->send(self->state.core, atom::store_v, atom::master_v,
-                 atom::snapshot_v, self->state.id, self);
+                 atom::snapshot_v, self->state.id, self, self->state.seq);
     },
     [=](atom::master, caf::error err) {
       if ( self->state.master )
@@ -409,9 +459,13 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
         [=](caf::unit_t&, store::stream_type::value_type y) {
           // TODO: our operator() overloads require mutable references, but
           //       only a fraction actually benefit from it.
-          auto cmd = move_command(y);
-          if (caf::holds_alternative<snapshot_sync_command>(cmd)) {
-            self->state.command(cmd);
+          auto seq = caf::get<1>(y).seq;
+          internal_command cmd{move_command(y)};
+          cmd.seq = seq;
+          if (auto sync = caf::get_if<snapshot_sync_command>(&cmd.content)) {
+            if (sync->remote_clone == self)
+              self->state.sync_seq = seq;
+            self->state.command(cmd.content);
             return;
           }
 
@@ -425,6 +479,40 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
 
           self->state.command(cmd);
         });
+    },
+    // --- snapshot stream from the master -------------------------------------
+    [=](caf::stream<snapshot_entry> in) {
+      BROKER_DEBUG("received snapshot stream handshake from master");
+      attach_stream_sink(
+        self,
+        // input stream
+        in,
+        // initialize state
+        [=](caf::unit_t&) {
+          self->state.start_snapshot();
+        },
+        // processing step
+        [=](caf::unit_t&, snapshot_entry x) {
+          self->state.apply_snapshot_entry(x);
+        },
+        // cleanup
+        [=](caf::unit_t&, const caf::error& err) {
+          if (!err) {
+            self->state.finish_snapshot();
+            return;
+          }
+          // Keep the partially applied snapshot and start over. The master
+          // sends a new snapshot_sync_command for the new snapshot.
+          BROKER_WARNING("snapshot stream aborted:" << err);
+          self->state.snapshot_stale_keys.clear();
+          self->state.awaiting_snapshot = true;
+          self->state.awaiting_snapshot_sync = true;
+          self->state.pending_remote_updates.clear();
+          if (self->state.master)
+            self->send(self->state.core, atom::store_v, atom::master_v,
+                       atom::snapshot_v, self->state.id, self,
+                       self->state.seq);
+        });
     }};
 }
 
@@ -38,6 +38,10 @@ bool try_again_later() {
 #include <poll.h>
 #include <unistd.h>
 
+#ifdef BROKER_LINUX
+#include <sys/eventfd.h>
+#endif
+
 #define PIPE_WRITE ::write
 
 #define PIPE_READ ::read
@@ -57,6 +61,91 @@ bool try_again_later() {
 
 namespace broker::detail {
 
+#ifdef BROKER_LINUX
+
+// The eventfd operates in semaphore mode and always blocks on reads. Each
+// transition of `pending_` from zero to non-zero adds exactly one to the
+// eventfd and each transition back to zero reads exactly one. A read may
+// block briefly if it races with the write of a concurrent `fire`, but never
+// consumes the signal for a later transition.
+
+flare::flare() : pending_(0) {
+  auto fd = ::eventfd(0, EFD_CLOEXEC | EFD_SEMAPHORE);
+  if (fd < 0) {
+    BROKER_ERROR("failed to create flare eventfd");
+    std::terminate();
+  }
+  fds_[0] = fd;
+  fds_[1] = fd;
+}
+
+flare::~flare() {
+  ::close(fds_[0]);
+}
+
+flare::native_socket flare::fd() const {
+  return fds_[0];
+}
+
+namespace {
+
+void eventfd_signal(int fd) {
+  uint64_t value = 1;
+  for (;;) {
+    if (::write(fd, &value, sizeof(value)) == sizeof(value))
+      return;
+    if (errno != EINTR) {
+      BROKER_ERROR("unable to write flare eventfd!");
+      std::terminate();
+    }
+  }
+}
+
+void eventfd_clear(int fd) {
+  uint64_t value = 0;
+  for (;;) {
+    if (::read(fd, &value, sizeof(value)) == sizeof(value))
+      return;
+    if (errno != EINTR) {
+      BROKER_ERROR("unable to read flare eventfd!");
+      std::terminate();
+    }
+  }
+}
+
+} // namespace
+
+void flare::fire(size_t num) {
+  if (num > 0 && pending_.fetch_add(num, std::memory_order_acq_rel) == 0)
+    eventfd_signal(fds_[1]);
+}
+
+size_t flare::extinguish() {
+  auto result = pending_.exchange(0, std::memory_order_acq_rel);
+  if (result > 0)
+    eventfd_clear(fds_[0]);
+  return result;
+}
+
+bool flare::extinguish_one() {
+  return extinguish_some(1) == 1;
+}
+
+size_t flare::extinguish_some(size_t num) {
+  auto old = pending_.load(std::memory_order_acquire);
+  size_t result = 0;
+  do {
+    result = std::min(old, num);
+  } while (result > 0
+           && !pending_.compare_exchange_weak(old, old - result,
+                                              std::memory_order_acq_rel));
+  if (result > 0 && result == old)
+    eventfd_clear(fds_[0]);
+  return result;
+}
+
+#else // BROKER_LINUX
+
 namespace {
 
 constexpr size_t stack_buffer_size = 256;
@@ -136,6 +225,8 @@ bool flare::extinguish_one() {
   }
 }
 
+#endif // BROKER_LINUX
+
 void flare::await_one() {
   BROKER_TRACE("");
   pollfd p = {fds_[0], POLLIN, 0};
@@ -1,12 +1,16 @@
 #include "broker/logger.hh" // Needs to come before CAF includes.
 
+#include <algorithm>
+
 #include <caf/actor.hpp>
-#include <caf/attach_stream_sink.hpp>
+#include <caf/attach_stream_source.hpp>
 #include <caf/behavior.hpp>
 #include <caf/error.hpp>
 #include <caf/event_based_actor.hpp>
 #include <caf/make_message.hpp>
+#include <caf/span.hpp>
 #include <caf/stateful_actor.hpp>
+#include <caf/stream_sink.hpp>
 #include <caf/sum_type.hpp>
 #include <caf/system_messages.hpp>
 #include <caf/unit.hpp>
@@ -14,6 +18,7 @@
 #include "broker/atoms.hh"
 #include "broker/convert.hh"
 #include "broker/data.hh"
+#include "broker/defaults.hh"
 #include "broker/store.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
@@ -25,6 +30,45 @@
 namespace broker {
 namespace detail {
 
+namespace {
+
+// Passes entire batches of the input stream to the master instead of handing
+// out one command at a time. This allows the master to apply each batch in a
+// single transaction.
+class master_sink : public caf::stream_sink<command_message> {
+public:
+  using super = caf::stream_sink<command_message>;
+
+  master_sink(caf::scheduled_actor* self, master_state* state)
+    : caf::stream_manager(self), super(self), state_(state) {
+    // nop
+  }
+
+protected:
+  void handle(caf::inbound_path*, caf::downstream_msg::batch& x) override {
+    BROKER_TRACE(BROKER_ARG(x));
+    using vec_type = std::vector<command_message>;
+    if (x.xs.match_elements<vec_type>()) {
+      auto& xs = x.xs.get_mutable_as<vec_type>(0);
+      cmds_.clear();
+      cmds_.reserve(xs.size());
+      for (auto& y : xs)
+        cmds_.emplace_back(move_command(y));
+      state_->command(caf::make_span(cmds_));
+      return;
+    }
+    BROKER_ERROR("received unexpected batch type (dropped)");
+  }
+
+private:
+  master_state* state_;
+
+  /// Buffers the commands of the current batch.
+  std::vector<internal_command> cmds_;
+};
+
+} // namespace <anonymous>
+
 static optional<timestamp> to_opt_timestamp(timestamp ts,
                                             optional<timespan> span) {
   return span ? ts + *span : optional<timestamp>();
@@ -32,9 +76,12 @@ static optional<timestamp> to_opt_timestamp(timestamp ts,
 
 void master_state::init(caf::event_based_actor* ptr, std::string&& nm,
                         backend_pointer&& bp, caf::actor&& parent,
-                        endpoint::clock* ep_clock) {
+                        endpoint::clock* ep_clock,
+                        size_t change_log_capacity) {
   super::init(ptr, ep_clock, std::move(nm), std::move(parent));
+  change_log_size = change_log_capacity;
   clones_topic = id / topics::clone_suffix;
+  clones_topic.intern();
   backend = std::move(bp);
   if (auto es = backend->expiries()) {
     for (auto& e : *es) {
@@ -51,11 +98,47 @@ void master_state::init(caf::event_based_actor* ptr, std::string&& nm,
 }
 
 void master_state::broadcast(internal_command&& x) {
-  self->send(core, atom::publish_v,
-             make_command_message(clones_topic, std::move(x)));
+  // Clones receive updates from their master directly. Hence, peers must not
+  // forward this traffic.
+  send_or_defer(core, atom::publish_v,
+                make_command_message(clones_topic, std::move(x)),
+                node_message_flags::no_forward);
+}
+
+void master_state::broadcast_change(internal_command&& x) {
+  x.seq = ++seq;
+  if (change_log_size == 0) {
+    if (!clones.empty())
+      broadcast(std::move(x));
+    return;
+  }
+  if (change_log.size() == change_log_size)
+    change_log.pop_front();
+  if (clones.empty()) {
+    change_log.emplace_back(std::move(x));
+    return;
+  }
+  change_log.emplace_back(x);
+  broadcast(std::move(x));
+}
+
+optional<std::vector<internal_command>>
+master_state::changes_since(uint64_t last_seq) {
+  if (last_seq == 0 || last_seq > seq)
+    return nil;
+  if (last_seq == seq)
+    return std::vector<internal_command>{};
+  if (change_log.empty() || change_log.front().seq > last_seq + 1)
+    return nil;
+  auto first = change_log.begin() + (last_seq + 1 - change_log.front().seq);
+  return std::vector<internal_command>{first, change_log.end()};
 }
 
 void master_state::remind(timespan expiry, const data& key) {
+  if (defer_output) {
+    deferred_reminders.emplace_back(expiry, key);
+    return;
+  }
   auto msg = caf::make_message(atom::expire_v, key);
   clock->send_later(self, expiry, std::move(msg));
 }
@@ -81,6 +164,64 @@ void master_state::command(internal_command::variant_type& cmd) {
   caf::visit(*this, cmd);
 }
 
+void master_state::command(caf::span<internal_command> cmds) {
+  // Snapshots and clear need a consistent view of the entire backend. Hence,
+  // we only group commands that modify a single key.
+  auto batchable = [](const internal_command& x) {
+    return caf::holds_alternative<put_command>(x.content)
+           || caf::holds_alternative<put_unique_command>(x.content)
+           || caf::holds_alternative<erase_command>(x.content)
+           || caf::holds_alternative<add_command>(x.content)
+           || caf::holds_alternative<subtract_command>(x.content);
+  };
+  auto i = cmds.begin();
+  auto e = cmds.end();
+  while (i != e) {
+    auto j = std::find_if_not(i, e, batchable);
+    if (j - i > 1) {
+      apply_batch(cmds.subspan(static_cast<size_t>(i - cmds.begin()),
+                               static_cast<size_t>(j - i)));
+    } else if (i != j) {
+      command(*i);
+    }
+    if (j != e)
+      command(*j++);
+    i = j;
+  }
+}
+
+void master_state::apply_batch(caf::span<internal_command> cmds) {
+  BROKER_DEBUG("apply" << cmds.size() << "commands in a single batch");
+  // Clones and subscribers must not see any change before the backend
+  // committed the entire batch.
+  auto first_seq = seq;
+  defer_output = true;
+  auto res = backend->apply_batch(cmds, [this](internal_command& x) {
+    command(x);
+  });
+  defer_output = false;
+  if (!res) {
+    BROKER_ERROR("failed to commit" << cmds.size()
+                                    << "commands:" << res.error());
+    // None of the changes took place. Hence, clones must not receive them.
+    while (!change_log.empty() && change_log.back().seq > first_seq)
+      change_log.pop_back();
+    seq = first_seq;
+    deferred_output.clear();
+    deferred_reminders.clear();
+    // Requesters of put_unique wait for a response. Since nothing changed,
+    // the put failed regardless of what the master tried to reply.
+    for (auto& cmd : cmds)
+      if (auto x = caf::get_if<put_unique_command>(&cmd.content))
+        self->send(x->who, data{false}, x->req_id);
+    return;
+  }
+  flush_output();
+  for (auto& [expiry, key] : deferred_reminders)
+    remind(expiry, key);
+  deferred_reminders.clear();
+}
+
 void master_state::operator()(none) {
   BROKER_INFO("received empty command");
 }
@@ -108,16 +249,16 @@ void master_state::operator()(put_unique_command& x) {
   if (exists(x.key)) {
     // Note that we don't bother broadcasting this operation to clones since
     // no change took place.
-    self->send(x.who, caf::make_message(data{false}, x.req_id));
+    send_or_defer(x.who, data{false}, x.req_id);
     return;
   }
   auto et = to_opt_timestamp(clock->now(), x.expiry);
   if (auto res = backend->put(x.key, x.value, et); !res) {
     BROKER_WARNING("failed to put_unique" << x.key << "->" << x.value);
-    self->send(x.who, caf::make_message(data{false}, x.req_id));
+    send_or_defer(x.who, data{false}, x.req_id);
     return;
   }
-  self->send(x.who, caf::make_message(data{true}, x.req_id));
+  send_or_defer(x.who, data{true}, x.req_id);
   if (x.expiry)
     remind(*x.expiry, x.key);
   emit_insert_event(x);
@@ -206,9 +347,6 @@ void master_state::operator()(snapshot_command& x) {
     BROKER_INFO("snapshot command with invalid address received");
     return;
   }
-  auto ss = backend->snapshot();
-  if (!ss)
-    die("failed to snapshot master");
   self->monitor(x.remote_core);
   clones.emplace(x.remote_core->address(), x.remote_clone);
 
@@ -216,21 +354,47 @@ void master_state::operator()(snapshot_command& x) {
   // so we send a "sync" point over the update channel that target clone
   // can use in order to apply any updates that arrived before it
   // received the now-outdated snapshot.
-  broadcast_cmd_to_clones(snapshot_sync_command{x.remote_clone});
-
-  // TODO: possible improvements to do here
-  // (1) Use a separate *streaming* channel to send the snapshot.
-  //     A benefit of that would potentially be less latent queries
-  //     that go directly against the master store.
-  // (2) Always keep an updated snapshot in memory on the master to
-  //     avoid numerous expensive retrievals from persistent backends
-  //     in quick succession (e.g. at startup).
-  // (3) As an alternative to (2), give backends an API to stream
-  //     key-value pairs without ever needing the full snapshot in
-  //     memory.  Note that this would require halting the application
-  //     of updates on the master while there are any snapshot streams
-  //     still underway.
-  self->send(x.remote_clone, set_command{std::move(*ss)});
+  internal_command sync{snapshot_sync_command{x.remote_clone}};
+  sync.seq = seq;
+  broadcast(std::move(sync));
+  // A clone that reconnects after a short outage only needs the commands it
+  // missed, as long as we still have them.
+  if (auto delta = changes_since(x.seq)) {
+    BROKER_INFO("send" << delta->size() << "commands after" << x.seq
+                       << "instead of a snapshot");
+    self->send(x.remote_clone, snapshot_delta{std::move(*delta)});
+    return;
+  }
+  // Stream the snapshot to the clone instead of sending it in a single
+  // message. The stream reads the backend in batches as the clone grants
+  // credit. Hence, the master keeps applying updates while the stream is
+  // underway and the snapshot may already include some of the updates after
+  // the sync point. Since the clone replays all of these updates after the
+  // snapshot and each update sets or removes a value, the clone still ends
+  // up with the state of the master.
+  struct stream_state {
+    backend_cursor_ptr cursor;
+    scan_entries buf;
+    bool at_end = false;
+  };
+  caf::attach_stream_source(
+    self, x.remote_clone,
+    [this](stream_state& st) { st.cursor = backend->scan(); },
+    [](stream_state& st, caf::downstream<snapshot_entry>& out, size_t hint) {
+      while (hint > 0 && !st.at_end) {
+        auto n = std::min(hint, defaults::store_scan_batch_size);
+        if (auto res = st.cursor->next(st.buf, n); !res)
+          die("failed to snapshot master");
+        if (st.buf.empty()) {
+          st.at_end = true;
+          return;
+        }
+        hint -= st.buf.size();
+        for (auto& y : st.buf)
+          out.push(snapshot_entry{std::move(y.key), std::move(y.value)});
+      }
+    },
+    [](const stream_state& st) { return st.at_end; });
 }
 
 void master_state::operator()(snapshot_sync_command&) {
@@ -243,20 +407,16 @@ void master_state::operator()(set_command& x) {
 
 void master_state::operator()(clear_command& x) {
   BROKER_INFO("CLEAR" << x);
-  if (auto keys_res = backend->keys(); !keys_res) {
-    BROKER_ERROR("unable to obtain keys:" << keys_res.error());
-    return;
-  } else {
-    if (auto keys = get_if<vector>(*keys_res)) {
-      for (auto& key : *keys)
-        emit_erase_event(key, x.publisher);
-    } else if (auto keys = get_if<set>(*keys_res)) {
-      for (auto& key : *keys)
-        emit_erase_event(key, x.publisher);
-    } else if (!is<none>(*keys_res)) {
-      BROKER_ERROR("backend->keys() returned an unexpected result type");
+  auto cursor = backend->scan();
+  scan_entries buf;
+  do {
+    if (auto res = cursor->next(buf, defaults::store_scan_batch_size); !res) {
+      BROKER_ERROR("unable to obtain keys:" << res.error());
+      return;
     }
-  }
+    for (auto& entry : buf)
+      emit_erase_event(entry.key, x.publisher);
+  } while (!buf.empty());
   if (auto res = backend->clear(); !res)
     die("failed to clear master");
   broadcast_cmd_to_clones(std::move(x));
@@ -271,10 +431,10 @@ bool master_state::exists(const data& key) {
 caf::behavior master_actor(caf::stateful_actor<master_state>* self,
                            caf::actor core, std::string id,
                            master_state::backend_pointer backend,
-                           endpoint::clock* clock) {
+                           endpoint::clock* clock, size_t change_log_size) {
   self->monitor(core);
   self->state.init(self, std::move(id), std::move(backend),
-                   std::move(core), clock);
+                   std::move(core), clock, change_log_size);
   self->set_down_handler(
     [=](const caf::down_msg& msg) {
       if (msg.source == core) {
@@ -350,25 +510,9 @@ caf::behavior master_actor(caf::stateful_actor<master_state>* self,
     // --- stream handshake with core ------------------------------------------
     [=](const store::stream_type& in) {
       BROKER_DEBUG("received stream handshake from core");
-      attach_stream_sink(
-        self,
-        // input stream
-        in,
-        // initialize state
-        [](caf::unit_t&) {
-          // nop
-        },
-        // processing step
-        [=](caf::unit_t&, store::stream_type::value_type y) {
-          // TODO: our operator() overloads require mutable references, but
-          //       only a fraction actually benefit from it.
-          auto cmd = move_command(y);
-          self->state.command(cmd);
-        },
-        // cleanup
-        [](caf::unit_t&, const caf::error&) {
-          // nop
-        });
+      auto mgr = caf::make_counted<master_sink>(self, &self->state);
+      if (mgr->add_unchecked_inbound_path(in) == caf::invalid_stream_slot)
+        BROKER_WARNING("failed to init stream to master");
     }
   };
 }
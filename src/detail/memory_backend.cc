@@ -1,13 +1,57 @@
 #include <set>
 #include <cstdint>
 #include <utility>
+#include <vector>
 
 #include "broker/detail/appliers.hh"
+#include "broker/detail/assert.hh"
 #include "broker/detail/memory_backend.hh"
 
 namespace broker {
 namespace detail {
 
+namespace {
+
+// Copies all keys when starting the scan and then walks this list in a fixed
+// order, looking up the current value for each key. Rehashing the table
+// between two calls to `next` has no effect on the position. The cursor
+// skips keys that get erased before it reaches them and never visits keys
+// that get added after starting the scan. Each key appears at most once.
+//
+// Unlike the SQLite and RocksDB cursors, this cursor is *not* bounded by the
+// batch size: starting a scan costs O(n) time and memory for the n keys in
+// the store. The hash table offers no position that survives rehashing, so
+// we trade the key copy for visiting each key exactly once. Values still get
+// copied one batch at a time.
+class memory_cursor : public backend_cursor {
+public:
+  explicit memory_cursor(const memory_backend::store_type* store)
+    : store_(store) {
+    keys_.reserve(store->size());
+    for (auto& kvp : *store)
+      keys_.emplace_back(kvp.first);
+  }
+
+  expected<void> next(scan_entries& out, size_t max_entries) override {
+    BROKER_ASSERT(max_entries > 0);
+    out.clear();
+    for (; out.size() < max_entries && pos_ < keys_.size(); ++pos_) {
+      auto& key = keys_[pos_];
+      auto i = store_->find(key);
+      if (i != store_->end())
+        out.emplace_back(scan_entry{std::move(key), i->second.first,
+                                    i->second.second});
+    }
+    return {};
+  }
+
+private:
+  const memory_backend::store_type* store_;
+  std::vector<data> keys_;
+  size_t pos_ = 0;
+};
+
+} // namespace <anonymous>
 
 memory_backend::memory_backend(backend_options opts)
   : options_{std::move(opts)} {
@@ -74,13 +118,6 @@ expected<data> memory_backend::get(const data& key) const {
   return i->second.first;
 }
 
-expected<data> memory_backend::keys() const {
-  set keys;
-  for ( auto i = store_.begin(); i != store_.end(); i++ )
-    keys.insert(i->first);
-  return expected<data>(std::move(keys));
-}
-
 expected<data> memory_backend::get(const data& key, const data& value) const {
   auto i = store_.find(key);
   if (i == store_.end())
@@ -99,11 +136,8 @@ expected<uint64_t> memory_backend::size() const {
   return store_.size();
 }
 
-expected<snapshot> memory_backend::snapshot() const {
-  broker::snapshot ss;
-  for (auto& p : store_)
-    ss.emplace(p.first, p.second.first);
-  return {std::move(ss)};
+backend_cursor_ptr memory_backend::scan() const {
+  return std::make_unique<memory_cursor>(&store_);
 }
 
 expected<expirables> memory_backend::expiries() const {
@@ -0,0 +1,112 @@
+#include "broker/detail/queue_stats.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+int64_t now_ns() {
+  auto t = queue_stats::clock_type::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+timespan ns_to_timespan(uint64_t ns) {
+  return std::chrono::duration_cast<timespan>(
+    std::chrono::nanoseconds{static_cast<int64_t>(ns)});
+}
+
+} // namespace
+
+// -- latency_histogram --------------------------------------------------------
+
+uint64_t latency_histogram::count() const noexcept {
+  uint64_t result = 0;
+  for (auto& x : buckets_)
+    result += x.load(std::memory_order_relaxed);
+  return result;
+}
+
+uint64_t latency_histogram::percentile(double p) const noexcept {
+  std::array<uint64_t, num_buckets> xs;
+  uint64_t total = 0;
+  for (size_t i = 0; i < num_buckets; ++i)
+    total += xs[i] = buckets_[i].load(std::memory_order_relaxed);
+  if (total == 0)
+    return 0;
+  auto rank = static_cast<uint64_t>(p * static_cast<double>(total));
+  rank = std::min(std::max(rank, uint64_t{1}), total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < num_buckets; ++i) {
+    seen += xs[i];
+    if (seen >= rank)
+      return std::min(upper_bound_of(i), max());
+  }
+  return max();
+}
+
+void latency_histogram::record(uint64_t value, uint64_t n) noexcept {
+  if (n == 0)
+    return;
+  buckets_[bucket_of(value)].fetch_add(n, std::memory_order_relaxed);
+  auto prev = max_.load(std::memory_order_relaxed);
+  while (prev < value
+         && !max_.compare_exchange_weak(prev, value, std::memory_order_relaxed))
+    ; // nop
+}
+
+size_t latency_histogram::bucket_of(uint64_t value) noexcept {
+  if (value < sub_buckets)
+    return static_cast<size_t>(value);
+  // Position of the most significant bit, at least sub_bucket_bits.
+  size_t msb = 63 - static_cast<size_t>(__builtin_clzll(value));
+  auto shift = msb - sub_bucket_bits;
+  auto sub = static_cast<size_t>(value >> shift) & (sub_buckets - 1);
+  return (shift + 1) * sub_buckets + sub;
+}
+
+uint64_t latency_histogram::upper_bound_of(size_t index) noexcept {
+  if (index < sub_buckets)
+    return index;
+  auto shift = index / sub_buckets - 1;
+  auto sub = static_cast<uint64_t>(index % sub_buckets);
+  auto lower = (sub_buckets + sub) << shift;
+  return lower + ((uint64_t{1} << shift) - 1);
+}
+
+// -- rate_meter ---------------------------------------------------------------
+
+rate_meter::rate_meter() : last_time_(now_ns()) {
+  // nop
+}
+
+size_t rate_meter::update(uint64_t counter) noexcept {
+  constexpr int64_t interval = 1000000000; // 1s
+  auto now = now_ns();
+  auto last = last_time_.load();
+  if (now - last >= interval && last_time_.compare_exchange_strong(last, now)) {
+    auto prev = last_count_.exchange(counter);
+    if (counter >= prev) {
+      auto secs = static_cast<double>(now - last) / interval;
+      rate_ = static_cast<size_t>(static_cast<double>(counter - prev) / secs);
+    }
+  }
+  return rate_.load();
+}
+
+// -- queue_stats --------------------------------------------------------------
+
+queue_metrics queue_stats::metrics(std::string name) const {
+  queue_metrics result;
+  result.name = std::move(name);
+  result.enqueued = enqueued();
+  result.dequeued = dequeued();
+  result.dropped = dropped();
+  result.latency_p50 = ns_to_timespan(latency_.percentile(0.5));
+  result.latency_p90 = ns_to_timespan(latency_.percentile(0.9));
+  result.latency_p99 = ns_to_timespan(latency_.percentile(0.99));
+  result.latency_max = ns_to_timespan(latency_.max());
+  return result;
+}
+
+} // namespace detail
+} // namespace broker
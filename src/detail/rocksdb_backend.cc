@@ -1,5 +1,7 @@
+#include <rocksdb/comparator.h>
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
+#include <rocksdb/utilities/write_batch_with_index.h>
 
 #include "broker/logger.hh"
 
@@ -45,11 +47,27 @@ data from_key_blob(const char* data, size_t size) {
 } // namespace <anonymous>
 
 struct rocksdb_backend::impl {
+  /// Calls `f` with a write batch and writes the batch to the database
+  /// afterwards. During `apply_batch`, `f` adds its updates to the pending
+  /// batch instead.
+  template <class F>
+  rocksdb::Status write(F f) {
+    if (pending) {
+      f(static_cast<rocksdb::WriteBatchBase&>(*pending));
+      return rocksdb::Status::OK();
+    }
+    rocksdb::WriteBatch batch;
+    f(static_cast<rocksdb::WriteBatchBase&>(batch));
+    return db->Write({}, &batch);
+  }
+
   template <class Key, class Value>
   bool put(const Key& key, const Value& value) {
     if (!db)
       return false;
-    auto status = db->Put({}, key, value);
+    auto status = write([&](rocksdb::WriteBatchBase& batch) {
+      batch.Put(key, value);
+    });
     if (!status.ok()) {
       BROKER_ERROR("failed put key-value-pair:" << status.ToString());
       return false;
@@ -61,16 +79,16 @@ struct rocksdb_backend::impl {
   bool put(Key& key, const Value& value, optional<timestamp> expiry) {
     if (!db)
       return false;
-    rocksdb::WriteBatch batch;
-    batch.Put(key, value);
-    // Write expiry.
-    if (expiry) {
-      BROKER_ASSERT(key.size() > 1);
-      key[0] = static_cast<char>(prefix::expiry); // reuse key blob
-      auto blob = to_blob(*expiry);
-      batch.Put(key, blob);
-    }
-    auto status = db->Write({}, &batch);
+    auto status = write([&](rocksdb::WriteBatchBase& batch) {
+      batch.Put(key, value);
+      // Write expiry.
+      if (expiry) {
+        BROKER_ASSERT(key.size() > 1);
+        key[0] = static_cast<char>(prefix::expiry); // reuse key blob
+        auto blob = to_blob(*expiry);
+        batch.Put(key, blob);
+      }
+    });
     if (!status.ok()) {
       BROKER_ERROR("failed to put key-value pair:" << status.ToString());
       return false;
@@ -83,12 +101,17 @@ struct rocksdb_backend::impl {
     if (!db)
       return ec::backend_failure;
     std::string value;
-    bool exists;
-    if (!db->KeyMayExist({}, key, &value, &exists))
-      return ec::no_such_key;
-    if (exists)
-      return value;
-    auto status = db->Get(rocksdb::ReadOptions{}, key, &value);
+    rocksdb::Status status;
+    if (pending) {
+      status = pending->GetFromBatchAndDB(db, {}, key, &value);
+    } else {
+      bool exists;
+      if (!db->KeyMayExist({}, key, &value, &exists))
+        return ec::no_such_key;
+      if (exists)
+        return value;
+      status = db->Get(rocksdb::ReadOptions{}, key, &value);
+    }
     if (status.IsNotFound())
       return ec::no_such_key;
     if (!status.ok()) {
@@ -105,13 +128,18 @@ struct rocksdb_backend::impl {
   expected<bool> exists(const Key& key) {
     if (!db)
       return ec::backend_failure;
-    bool exists;
     std::string value; // unused, but can't pass nullptr
-    if (!db->KeyMayExist({}, key, &value, &exists))
-      return false;
-    if (exists)
-      return true;
-    auto status = db->Get(rocksdb::ReadOptions{}, key, nullptr);
+    rocksdb::Status status;
+    if (pending) {
+      status = pending->GetFromBatchAndDB(db, {}, key, &value);
+    } else {
+      bool exists;
+      if (!db->KeyMayExist({}, key, &value, &exists))
+        return false;
+      if (exists)
+        return true;
+      status = db->Get(rocksdb::ReadOptions{}, key, nullptr);
+    }
     if (status.IsNotFound())
       return false;
     if (!status.ok()) {
@@ -125,7 +153,9 @@ struct rocksdb_backend::impl {
   expected<void> erase(const Key& key) {
     if (!db)
       return ec::backend_failure;
-    auto status = db->Delete({}, key);
+    auto status = write([&](rocksdb::WriteBatchBase& batch) {
+      batch.Delete(key);
+    });
     if (!status.ok()) {
       BROKER_ERROR("failed to delete key:" << status.ToString());
       return ec::backend_failure;
@@ -133,8 +163,76 @@ struct rocksdb_backend::impl {
   }
 
   rocksdb::DB* db = nullptr;
+  /// Collects all updates during `apply_batch`.
+  std::unique_ptr<rocksdb::WriteBatchWithIndex> pending;
   count exact_size_threshold = 10000;
   std::string path;
+
+  class cursor;
+};
+
+// Iterates over the data key space in key order. Each batch seeks a new
+// iterator to the last key of the previous batch, i.e., modifying or even
+// clearing the database between two batches cannot invalidate the cursor.
+class rocksdb_backend::impl::cursor : public backend_cursor {
+public:
+  explicit cursor(impl* ptr) : impl_(ptr) {
+    // nop
+  }
+
+  expected<void> next(scan_entries& out, size_t max_entries) override {
+    BROKER_ASSERT(max_entries > 0);
+    out.clear();
+    if (!impl_->db)
+      return ec::backend_failure;
+    static const auto pfx = static_cast<char>(prefix::data);
+    rocksdb::ReadOptions opts;
+    opts.fill_cache = false;
+    auto i = std::unique_ptr<rocksdb::Iterator>{impl_->db->NewIterator(opts)};
+    if (last_key_.empty()) {
+      i->Seek(rocksdb::Slice{&pfx, 1});
+    } else {
+      i->Seek(last_key_);
+      if (i->Valid() && i->key() == rocksdb::Slice{last_key_})
+        i->Next();
+    }
+    // Expiries use the same key blobs with a different prefix, i.e., they
+    // have the same order as the data keys. A second iterator picks them up
+    // while walking the data keys.
+    auto e = std::unique_ptr<rocksdb::Iterator>{impl_->db->NewIterator(opts)};
+    std::string expiry_key;
+    bool seeked = false;
+    while (out.size() < max_entries && i->Valid() && i->key()[0] == pfx) {
+      auto key = from_key_blob<prefix::data>(i->key().data(), i->key().size());
+      auto value = from_blob<data>(i->value().data(), i->value().size());
+      expiry_key.assign(i->key().data(), i->key().size());
+      expiry_key[0] = static_cast<char>(prefix::expiry);
+      if (!seeked) {
+        e->Seek(expiry_key);
+        seeked = true;
+      } else {
+        while (e->Valid() && e->key().compare(expiry_key) < 0)
+          e->Next();
+      }
+      optional<timestamp> expiry;
+      if (e->Valid() && e->key() == rocksdb::Slice{expiry_key})
+        expiry = from_blob<timestamp>(e->value().data(), e->value().size());
+      out.emplace_back(scan_entry{std::move(key), std::move(value), expiry});
+      last_key_.assign(i->key().data(), i->key().size());
+      i->Next();
+    }
+    if (!i->status().ok() || !e->status().ok()) {
+      BROKER_ERROR("failed to scan:" << i->status().ToString()
+                                     << e->status().ToString());
+      out.clear();
+      return ec::backend_failure;
+    }
+    return {};
+  }
+
+private:
+  impl* impl_;
+  std::string last_key_;
 };
 
 rocksdb_backend::rocksdb_backend(backend_options opts)
@@ -245,12 +343,12 @@ expected<void> rocksdb_backend::subtract(const data& key, const data& value,
 expected<void> rocksdb_backend::erase(const data& key) {
   if (!impl_->db)
     return ec::backend_failure;
-  rocksdb::WriteBatch batch;
   auto key_blob = to_key_blob<prefix::data>(key);
-  batch.Delete(key_blob);
-  key_blob[0] = static_cast<char>(prefix::expiry);
-  batch.Delete(key_blob);
-  auto status = impl_->db->Write({}, &batch);
+  auto status = impl_->write([&](rocksdb::WriteBatchBase& batch) {
+    batch.Delete(key_blob);
+    key_blob[0] = static_cast<char>(prefix::expiry);
+    batch.Delete(key_blob);
+  });
   if (!status.ok()) {
     BROKER_ERROR("failed to delete key:" << status.ToString());
     return ec::backend_failure;
@@ -261,6 +359,10 @@ expected<void> rocksdb_backend::erase(const data& key) {
 expected<void> rocksdb_backend::clear() {
   if (!impl_->db)
     return ec::backend_failure;
+  if (impl_->pending) {
+    BROKER_ERROR("cannot clear the database during a batch");
+    return ec::backend_failure;
+  }
   std::string path = impl_->path;
   delete impl_->db;
   impl_->db = nullptr;
@@ -287,11 +389,11 @@ expected<bool> rocksdb_backend::expire(const data& key, timestamp ts) {
   auto expiry = from_blob<timestamp>(*expiry_blob);
   if (ts < expiry)
     return false;
-  rocksdb::WriteBatch batch;
-  batch.Delete(key_blob);
-  key_blob[0] = static_cast<char>(prefix::data);
-  batch.Delete(key_blob);
-  auto status = impl_->db->Write({}, &batch);
+  auto status = impl_->write([&](rocksdb::WriteBatchBase& batch) {
+    batch.Delete(key_blob);
+    key_blob[0] = static_cast<char>(prefix::data);
+    batch.Delete(key_blob);
+  });
   if (!status.ok()) {
     BROKER_ERROR("failed to delete key:" << status.ToString());
     return ec::backend_failure;
@@ -299,32 +401,33 @@ expected<bool> rocksdb_backend::expire(const data& key, timestamp ts) {
   return true;
 }
 
-expected<data> rocksdb_backend::get(const data& key) const {
-  auto value_blob = impl_->get(to_key_blob<prefix::data>(key));
-  if (!value_blob)
-    return value_blob.error();
-  return from_blob<data>(*value_blob);
+expected<void> rocksdb_backend::begin_batch() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  // Overwriting keys in the index makes lookups during the batch return the
+  // most recent value for each key.
+  impl_->pending = std::make_unique<rocksdb::WriteBatchWithIndex>(
+    rocksdb::BytewiseComparator(), 0, true);
+  return {};
 }
 
-expected<data> rocksdb_backend::keys() const {
-  if (!impl_->db)
+expected<void> rocksdb_backend::commit_batch() {
+  auto batch = std::move(impl_->pending);
+  if (!impl_->db || !batch)
     return ec::backend_failure;
-  set result;
-  rocksdb::ReadOptions opts;
-  opts.fill_cache = false;
-  auto i = std::unique_ptr<rocksdb::Iterator>{impl_->db->NewIterator(opts)};
-  static const auto pfx = static_cast<char>(prefix::data);
-  i->Seek(rocksdb::Slice{&pfx, 1}); // initializes iterator
-  while (i->Valid() && i->key()[0] == pfx) {
-    auto key = from_key_blob<prefix::data>(i->key().data(), i->key().size());
-    result.insert(std::move(key));
-    i->Next();
-  }
-  if (!i->status().ok()) {
-    BROKER_ERROR("failed to get keys:" << i->status().ToString());
+  auto status = impl_->db->Write({}, batch->GetWriteBatch());
+  if (!status.ok()) {
+    BROKER_ERROR("failed to write batch:" << status.ToString());
     return ec::backend_failure;
   }
-  return {std::move(result)};
+  return {};
+}
+
+expected<data> rocksdb_backend::get(const data& key) const {
+  auto value_blob = impl_->get(to_key_blob<prefix::data>(key));
+  if (!value_blob)
+    return value_blob.error();
+  return from_blob<data>(*value_blob);
 }
 
 expected<bool> rocksdb_backend::exists(const data& key) const {
@@ -356,26 +459,8 @@ expected<uint64_t> rocksdb_backend::size() const {
   return result;
 }
 
-expected<snapshot> rocksdb_backend::snapshot() const {
-  if (!impl_->db)
-    return ec::backend_failure;
-  broker::snapshot result;
-  rocksdb::ReadOptions opts;
-  opts.fill_cache = false;
-  auto i = std::unique_ptr<rocksdb::Iterator>{impl_->db->NewIterator(opts)};
-  static const auto pfx = static_cast<char>(prefix::data);
-  i->Seek(rocksdb::Slice{&pfx, 1}); // initializes iterator
-  while (i->Valid() && i->key()[0] == pfx) {
-    auto key = from_key_blob<prefix::data>(i->key().data(), i->key().size());
-    auto value = from_blob<data>(i->value().data(), i->value().size());
-    result.emplace(std::move(key), std::move(value));
-    i->Next();
-  }
-  if (!i->status().ok()) {
-    BROKER_ERROR("failed to compute size:" << i->status().ToString());
-    return ec::backend_failure;
-  }
-  return {std::move(result)};
+backend_cursor_ptr rocksdb_backend::scan() const {
+  return std::make_unique<impl::cursor>(impl_.get());
 }
 
 expected<expirables> rocksdb_backend::expiries() const {
@@ -117,10 +117,14 @@ struct sqlite_backend::impl {
       {&lookup, "select value from store where key = ?;"},
       {&exists, "select 1 from store where key = ?;"},
       {&size, "select count(*) from store;"},
-      {&snapshot, "select key, value from store;"},
+      {&scan, "select key, value, expiry from store where key > ? "
+              "order by key limit ?;"},
       {&expiries, "select key, expiry from store where expiry is not null;"},
       {&clear, "delete from store;"},
-      {&keys, "select key from store;"},
+
+      {&begin, "begin transaction;"},
+      {&commit, "commit transaction;"},
+      {&rollback, "rollback transaction;"},
     };
     auto prepare = [&](sqlite3_stmt** stmt, const char* sql) {
       finalize.push_back(*stmt);
@@ -178,11 +182,75 @@ struct sqlite_backend::impl {
   sqlite3_stmt* lookup = nullptr;
   sqlite3_stmt* exists = nullptr;
   sqlite3_stmt* size = nullptr;
-  sqlite3_stmt* snapshot = nullptr;
+  sqlite3_stmt* scan = nullptr;
   sqlite3_stmt* expiries = nullptr;
   sqlite3_stmt* clear = nullptr;
-  sqlite3_stmt* keys = nullptr;
+  sqlite3_stmt* begin = nullptr;
+  sqlite3_stmt* commit = nullptr;
+  sqlite3_stmt* rollback = nullptr;
   std::vector<sqlite3_stmt*> finalize;
+
+  class cursor;
+};
+
+// Pages through the store in key order. Each batch starts a new query for
+// the keys following the last key of the previous batch, i.e., modifying the
+// store between two batches cannot invalidate the cursor.
+class sqlite_backend::impl::cursor : public backend_cursor {
+public:
+  explicit cursor(impl* ptr) : impl_(ptr) {
+    // nop
+  }
+
+  expected<void> next(scan_entries& out, size_t max_entries) override {
+    BROKER_ASSERT(max_entries > 0);
+    out.clear();
+    if (!impl_->db)
+      return ec::backend_failure;
+    auto stmt = impl_->scan;
+    // Receives the last key of this batch. SQLite keeps pointing to the
+    // buffer of `last_key_` until the guard resets the statement. Hence, we
+    // must not modify `last_key_` while stepping. Declaring `next_key`
+    // before the guard also keeps the old buffer alive until the reset.
+    std::string next_key;
+    auto guard = make_statement_guard(stmt);
+    // Bind the last key of the previous batch. All keys are non-empty blobs,
+    // i.e., the empty blob selects the first batch.
+    auto result = last_key_.empty()
+                    ? sqlite3_bind_zeroblob(stmt, 1, 0)
+                    : sqlite3_bind_blob64(stmt, 1, last_key_.data(),
+                                          last_key_.size(), SQLITE_STATIC);
+    if (result != SQLITE_OK)
+      return ec::backend_failure;
+    // Bind limit.
+    result = sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(max_entries));
+    if (result != SQLITE_OK)
+      return ec::backend_failure;
+    // Execute query.
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+      auto key_blob = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+      auto key_size = sqlite3_column_bytes(stmt, 0);
+      auto key = from_blob<data>(key_blob, key_size);
+      auto value = from_blob<data>(sqlite3_column_blob(stmt, 1),
+                                   sqlite3_column_bytes(stmt, 1));
+      optional<timestamp> expiry;
+      if (sqlite3_column_type(stmt, 2) != SQLITE_NULL)
+        expiry = timestamp{timespan{sqlite3_column_int64(stmt, 2)}};
+      out.emplace_back(scan_entry{std::move(key), std::move(value), expiry});
+      next_key.assign(key_blob, static_cast<size_t>(key_size));
+    }
+    if (result != SQLITE_DONE) {
+      out.clear();
+      return ec::backend_failure;
+    }
+    if (!out.empty())
+      last_key_.swap(next_key);
+    return {};
+  }
+
+private:
+  impl* impl_;
+  std::string last_key_;
 };
 
 
@@ -302,6 +370,35 @@ expected<bool> sqlite_backend::expire(const data& key, timestamp ts) {
   return sqlite3_changes(impl_->db) == 1;
 }
 
+expected<void> sqlite_backend::begin_batch() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  auto guard = make_statement_guard(impl_->begin);
+  if (sqlite3_step(impl_->begin) != SQLITE_DONE) {
+    BROKER_ERROR("failed to begin transaction:" << sqlite3_errmsg(impl_->db));
+    return ec::backend_failure;
+  }
+  return {};
+}
+
+expected<void> sqlite_backend::commit_batch() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  auto guard = make_statement_guard(impl_->commit);
+  if (sqlite3_step(impl_->commit) == SQLITE_DONE)
+    return {};
+  BROKER_ERROR("failed to commit transaction:" << sqlite3_errmsg(impl_->db));
+  // SQLite may have rolled back the transaction already. Otherwise, we need
+  // to roll back manually to leave the transaction.
+  if (sqlite3_get_autocommit(impl_->db) == 0) {
+    auto rollback_guard = make_statement_guard(impl_->rollback);
+    if (sqlite3_step(impl_->rollback) != SQLITE_DONE)
+      BROKER_ERROR("failed to roll back transaction:"
+                   << sqlite3_errmsg(impl_->db));
+  }
+  return ec::backend_failure;
+}
+
 expected<data> sqlite_backend::get(const data& key) const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -320,22 +417,6 @@ expected<data> sqlite_backend::get(const data& key) const {
                          sqlite3_column_bytes(impl_->lookup, 0));
 }
 
-expected<data> sqlite_backend::keys() const {
-  if (!impl_->db)
-    return ec::backend_failure;
-  auto guard = make_statement_guard(impl_->keys);
-  set keys;
-  auto result = SQLITE_DONE;
-  while ((result = sqlite3_step(impl_->keys)) == SQLITE_ROW) {
-    auto key = from_blob<data>(sqlite3_column_blob(impl_->keys, 0),
-                               sqlite3_column_bytes(impl_->keys, 0));
-    keys.insert(std::move(key));
-  }
-  if (result == SQLITE_DONE)
-    return {std::move(keys)};
-  return ec::backend_failure;
-}
-
 expected<bool> sqlite_backend::exists(const data& key) const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -366,22 +447,8 @@ expected<uint64_t> sqlite_backend::size() const {
 	return sqlite3_column_int(impl_->size, 0);
 }
 
-expected<snapshot> sqlite_backend::snapshot() const {
-  if (!impl_->db)
-    return ec::backend_failure;
-  auto guard = make_statement_guard(impl_->snapshot);
-  broker::snapshot ss;
-  auto result = SQLITE_DONE;
-  while ((result = sqlite3_step(impl_->snapshot)) == SQLITE_ROW) {
-    auto key = from_blob<data>(sqlite3_column_blob(impl_->snapshot, 0),
-                               sqlite3_column_bytes(impl_->snapshot, 0));
-    auto value = from_blob<data>(sqlite3_column_blob(impl_->snapshot, 1),
-                                 sqlite3_column_bytes(impl_->snapshot, 1));
-    ss.emplace(std::move(key), std::move(value));
-  }
-  if (result == SQLITE_DONE)
-    return {std::move(ss)};
-  return ec::backend_failure;
+backend_cursor_ptr sqlite_backend::scan() const {
+  return std::make_unique<impl::cursor>(impl_.get());
 }
 
 expected<expirables> sqlite_backend::expiries() const {
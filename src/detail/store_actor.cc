@@ -64,8 +64,8 @@ void store_actor_state::emit_insert_event(const data& key, const data& value,
                                           const publisher_id& publisher) {
   vector xs;
   fill_vector(xs, "insert"s, id, key, value, expiry, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  send_or_defer(core, atom::publish_v, atom::local_v,
+                make_data_message(dst, data{std::move(xs)}));
 }
 
 void store_actor_state::emit_update_event(const data& key,
@@ -75,24 +75,30 @@ void store_actor_state::emit_update_event(const data& key,
                                           const publisher_id& publisher) {
   vector xs;
   fill_vector(xs, "update"s, id, key, old_value, new_value, expiry, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  send_or_defer(core, atom::publish_v, atom::local_v,
+                make_data_message(dst, data{std::move(xs)}));
 }
 
 void store_actor_state::emit_erase_event(const data& key,
                                          const publisher_id& publisher) {
   vector xs;
   fill_vector(xs, "erase"s, id, key, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  send_or_defer(core, atom::publish_v, atom::local_v,
+                make_data_message(dst, data{std::move(xs)}));
 }
 
 void store_actor_state::emit_expire_event(const data& key,
                                           const publisher_id& publisher) {
   vector xs;
   fill_vector(xs, "expire"s, id, key, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  send_or_defer(core, atom::publish_v, atom::local_v,
+                make_data_message(dst, data{std::move(xs)}));
+}
+
+void store_actor_state::flush_output() {
+  for (auto& [hdl, msg] : deferred_output)
+    self->send(hdl, std::move(msg));
+  deferred_output.clear();
 }
 
 } // namespace broker::detail
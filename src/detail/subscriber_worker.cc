@@ -0,0 +1,161 @@
+#include "broker/logger.hh" // Must come before any CAF include.
+#include "broker/detail/subscriber_worker.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <caf/scheduled_actor.hpp>
+#include <caf/send.hpp>
+#include <caf/stateful_actor.hpp>
+
+#include "broker/atoms.hh"
+#include "broker/endpoint.hh"
+#include "broker/filter_type.hh"
+#include "broker/message.hh"
+
+#include "broker/detail/assert.hh"
+
+using namespace caf;
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+using queue_ptr = shared_subscriber_queue_ptr<>;
+
+using queue_list = std::vector<queue_ptr>;
+
+struct subscriber_worker_state {
+  static const char* name;
+};
+
+const char* subscriber_worker_state::name = "subscriber_worker";
+
+class subscriber_sink : public stream_sink<data_message> {
+public:
+  using super = stream_sink<data_message>;
+
+  subscriber_sink(scheduled_actor* self, queue_list queues, shard_function f,
+                  size_t max_qsize, overflow_policy policy)
+    : stream_manager(self),
+      super(self),
+      queues_(std::move(queues)),
+      shards_(queues_.size()),
+      f_(std::move(f)),
+      max_qsize_(max_qsize),
+      policy_(policy) {
+    BROKER_ASSERT(!queues_.empty());
+  }
+
+  bool congested() const noexcept override {
+    // Only blocking subscribers withhold credit. All other policies discard
+    // messages instead of throttling the core.
+    if (policy_ != overflow_policy::block)
+      return false;
+    return std::any_of(queues_.begin(), queues_.end(), [this](const auto& q) {
+      return q->buffer_size() >= max_qsize_;
+    });
+  }
+
+protected:
+  void handle(inbound_path*, downstream_msg::batch& x) override {
+    BROKER_TRACE(BROKER_ARG(x));
+    using vec_type = std::vector<data_message>;
+    if (x.xs.match_elements<vec_type>()) {
+      auto& xs = x.xs.get_mutable_as<vec_type>(0);
+      if (queues_.size() == 1) {
+        produce(*queues_.front(), xs);
+        return;
+      }
+      for (auto& msg : xs)
+        shards_[f_(get_topic(msg)) % shards_.size()].emplace_back(
+          std::move(msg));
+      for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!shards_[i].empty()) {
+          produce(*queues_[i], shards_[i]);
+          shards_[i].clear();
+        }
+      }
+      return;
+    }
+    BROKER_ERROR("received unexpected batch type (dropped)");
+  }
+
+private:
+  void produce(shared_subscriber_queue<>& q, std::vector<data_message>& xs) {
+    auto first = std::make_move_iterator(xs.begin());
+    auto last = std::make_move_iterator(xs.end());
+    if (policy_ == overflow_policy::block) {
+      q.produce(xs.size(), first, last);
+      return;
+    }
+    auto dropped = q.produce_bounded(policy_, max_qsize_, first, last);
+    if (dropped > 0)
+      BROKER_DEBUG("subscriber queue full, dropped" << dropped << "messages");
+  }
+
+  queue_list queues_;
+
+  /// Collects the messages of a batch per queue.
+  std::vector<std::vector<data_message>> shards_;
+
+  shard_function f_;
+  size_t max_qsize_;
+  overflow_policy policy_;
+};
+
+behavior subscriber_worker(stateful_actor<subscriber_worker_state>* self,
+                           endpoint* ep, queue_list qs, shard_function f,
+                           std::vector<topic> ts, size_t max_qsize,
+                           overflow_policy policy) {
+  self->send(self * ep->core(), atom::join_v, std::move(ts));
+  self->set_default_handler(skip);
+  return {
+    [=](const endpoint::stream_type& in) {
+      auto mgr = make_counted<subscriber_sink>(self, qs, f, max_qsize,
+                                               policy);
+      auto slot = mgr->add_unchecked_inbound_path(in);
+      if (slot == invalid_stream_slot) {
+        BROKER_WARNING("failed to init stream to subscriber_worker");
+        return;
+      }
+      auto path = mgr->get_inbound_path(slot);
+      BROKER_ASSERT(path != nullptr);
+      auto slot_at_sender = path->slots.sender;
+      self->set_default_handler(print_and_drop);
+      self->become(
+        [=](atom::resume) {
+          // Triggering the actor should be enough to have it check its mailbox
+          // again in order to handle batches from a previously congested
+          // manager. The message does not tell us which queue requested it.
+          for (auto& q : qs)
+            q->clear_resume();
+        },
+        [=](atom::join a0, atom::update a1, filter_type& f) {
+          self->send(ep->core(), a0, a1, slot_at_sender, std::move(f));
+        },
+        [=](atom::join a0, atom::update a1, filter_type& f, caf::actor& who) {
+          self->send(ep->core(), a0, a1, slot_at_sender, std::move(f),
+                     std::move(who));
+        }
+      );
+    }
+  };
+}
+
+} // namespace <anonymous>
+
+caf::actor spawn_subscriber_worker(endpoint& ep, queue_list queues,
+                                   shard_function f, std::vector<topic> ts,
+                                   size_t max_qsize, overflow_policy policy) {
+  BROKER_ASSERT(!queues.empty());
+  if (!f)
+    f = [](const topic& t) { return t.hash(); };
+  return ep.system().spawn(subscriber_worker, &ep, std::move(queues),
+                           std::move(f), std::move(ts), max_qsize, policy);
+}
+
+} // namespace detail
+} // namespace broker
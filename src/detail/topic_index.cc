@@ -0,0 +1,68 @@
+#include "broker/detail/topic_index.hh"
+
+#include <algorithm>
+
+namespace broker {
+namespace detail {
+
+void topic_index::clear() {
+  tree_.clear();
+  cache_.clear();
+  id_cache_.clear();
+}
+
+void topic_index::add(id_type id, const filter_type& filter) {
+  cache_.clear();
+  id_cache_.clear();
+  for (auto& x : filter) {
+    auto& ids = tree_[x.string()];
+    auto i = std::lower_bound(ids.begin(), ids.end(), id);
+    if (i == ids.end() || *i != id)
+      ids.insert(i, id);
+  }
+}
+
+const topic_index::id_list& topic_index::matches(const topic& t) {
+  if (tree_.empty())
+    return empty_result_;
+  if (auto id = t.id(); id != 0) {
+    if (auto i = id_cache_.find(id); i != id_cache_.end())
+      return i->second;
+    prepare_cache_insert();
+    auto& result = id_cache_[id];
+    lookup(t.string(), result);
+    return result;
+  }
+  auto& str = t.string();
+  if (auto i = cache_.find(str); i != cache_.end())
+    return i->second;
+  prepare_cache_insert();
+  auto& result = cache_[str];
+  lookup(str, result);
+  return result;
+}
+
+void topic_index::lookup(const std::string& str, id_list& result) const {
+  auto hits = tree_.prefix_of(str);
+  if (hits.size() == 1) {
+    // Fast path: a single subscription matches, no need to merge.
+    result = hits.front()->second;
+    return;
+  }
+  for (auto& hit : hits) {
+    auto& ids = hit->second;
+    result.insert(result.end(), ids.begin(), ids.end());
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+void topic_index::prepare_cache_insert() {
+  if (cache_size() >= max_cache_size) {
+    cache_.clear();
+    id_cache_.clear();
+  }
+}
+
+} // namespace detail
+} // namespace broker
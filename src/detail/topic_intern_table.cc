@@ -0,0 +1,66 @@
+#include "broker/detail/topic_intern_table.hh"
+
+#include <functional>
+#include <mutex>
+
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+// Mirrors the algorithm in topic::split.
+auto make_segments(const std::string& str) {
+  std::vector<std::pair<size_t, size_t>> result;
+  std::string::size_type i = 0;
+  while (i != std::string::npos) {
+    auto j = str.find(topic::sep, i);
+    if (j == i) {
+      ++i;
+      continue;
+    }
+    if (j == std::string::npos) {
+      result.emplace_back(i, str.size() - i);
+      break;
+    }
+    result.emplace_back(i, j - i);
+    i = (j == str.size() - 1) ? std::string::npos : j + 1;
+  }
+  return result;
+}
+
+} // namespace
+
+const interned_topic* topic_intern_table::intern(const std::string& str) {
+  { // Lifetime scope of the reader lock.
+    std::shared_lock<std::shared_mutex> guard{mtx_};
+    if (auto i = lookup_.find(str); i != lookup_.end())
+      return i->second;
+  }
+  std::unique_lock<std::shared_mutex> guard{mtx_};
+  // Check again, since another thread may have interned `str` in the meantime.
+  if (auto i = lookup_.find(str); i != lookup_.end())
+    return i->second;
+  if (entries_.size() >= max_size)
+    return nullptr;
+  auto id = static_cast<uint32_t>(entries_.size() + 1);
+  auto& entry = entries_.emplace_back(interned_topic{
+    id, std::hash<std::string>{}(str), str, make_segments(str)});
+  lookup_.emplace(entry.str, &entry);
+  return &entry;
+}
+
+size_t topic_intern_table::size() const {
+  std::shared_lock<std::shared_mutex> guard{mtx_};
+  return entries_.size();
+}
+
+topic_intern_table& topic_intern_table::instance() {
+  // Deliberately leaked: topics may outlive static destructors.
+  static auto table = new topic_intern_table;
+  return *table;
+}
+
+} // namespace detail
+} // namespace broker
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <unordered_set>
 
 #include <caf/config.hpp>
@@ -162,10 +165,22 @@ void pretty_print(std::ostream& out, const caf::settings& xs,
   }
 }
 
+// Generates a name for the queue of a subscriber in `endpoint::metrics`.
+std::string queue_name(const char* prefix, const std::vector<topic>& ts) {
+  std::string result = prefix;
+  for (size_t i = 0; i < ts.size(); ++i) {
+    result += i == 0 ? ' ' : ',';
+    result += ts[i].string();
+  }
+  return result;
+}
+
 } // namespace
 
 endpoint::endpoint(configuration config)
   : config_(std::move(config)),
+    ingress_(detail::make_ingress_queue()),
+    stats_(detail::make_core_stats()),
     await_stores_on_shutdown_(false),
     destroyed_(false) {
   // Stop immediately if any helptext was printed.
@@ -196,6 +211,7 @@ endpoint::endpoint(configuration config)
       detail::die("CAF OpenSSL manager is not available");
   BROKER_INFO("creating endpoint");
   core_ = system_.spawn(core_actor, filter_type{}, config_.options(), clock_);
+  caf::anon_send(core_, atom::metrics_v, stats_);
 }
 
 endpoint::~endpoint() {
@@ -344,8 +360,7 @@ void endpoint::forward(std::vector<topic> ts)
 
 void endpoint::publish(topic t, data d) {
   BROKER_INFO("publishing" << std::make_pair(t, d));
-  caf::anon_send(core(), atom::publish_v,
-                 make_data_message(std::move(t), std::move(d)));
+  publish(make_data_message(std::move(t), std::move(d)));
 }
 
 void endpoint::publish(const endpoint_info& dst, topic t, data d) {
@@ -356,19 +371,29 @@ void endpoint::publish(const endpoint_info& dst, topic t, data d) {
 
 void endpoint::publish(data_message x){
   BROKER_INFO("publishing" << x);
-  caf::anon_send(core(), atom::publish_v, std::move(x));
+  if (ingress_->xs.push(std::move(x)))
+    caf::anon_send(core(), atom::publish_v, ingress_);
 }
 
-
 void endpoint::publish(std::vector<data_message> xs) {
   BROKER_INFO("publishing" << xs.size() << "messages");
-  for (auto& x : xs)
-    publish(std::move(x));
+  if (ingress_->xs.push(std::make_move_iterator(xs.begin()),
+                        std::make_move_iterator(xs.end())))
+    caf::anon_send(core(), atom::publish_v, ingress_);
 }
 
 publisher endpoint::make_publisher(topic ts) {
-  publisher result{*this, std::move(ts)};
+  auto& opts = config_.options();
+  return make_publisher(std::move(ts), opts.publisher_queue_size,
+                        opts.publisher_queue_max_size);
+}
+
+publisher endpoint::make_publisher(topic ts, size_t capacity,
+                                   size_t max_capacity) {
+  auto name = "publisher " + ts.string();
+  publisher result{*this, std::move(ts), capacity, max_capacity};
   children_.emplace_back(result.worker());
+  register_queue(std::move(name), result.queue_);
   return result;
 }
 
@@ -378,12 +403,61 @@ status_subscriber endpoint::make_status_subscriber(bool receive_statuses) {
   return result;
 }
 
-subscriber endpoint::make_subscriber(std::vector<topic> ts, size_t max_qsize) {
-  subscriber result{*this, std::move(ts), max_qsize};
+subscriber endpoint::make_subscriber(std::vector<topic> ts, size_t max_qsize,
+                                     queue_kind kind, overflow_policy policy) {
+  auto name = queue_name("subscriber", ts);
+  subscriber result{*this, std::move(ts), max_qsize, kind, policy};
+  children_.emplace_back(result.worker());
+  register_queue(std::move(name), result.queue_);
+  return result;
+}
+
+sharded_subscriber
+endpoint::make_sharded_subscriber(std::vector<topic> ts, size_t num_shards,
+                                  sharded_subscriber::shard_function f,
+                                  size_t max_qsize, queue_kind kind,
+                                  overflow_policy policy) {
+  auto name = queue_name("subscriber", ts);
+  sharded_subscriber result{*this, std::move(ts), num_shards, std::move(f),
+                            max_qsize, kind, policy};
   children_.emplace_back(result.worker());
+  for (size_t i = 0; i < result.size(); ++i)
+    register_queue(name + " shard " + std::to_string(i), result[i].queue_);
+  return result;
+}
+
+std::vector<queue_metrics> endpoint::metrics() {
+  std::vector<queue_metrics> result;
+  std::unique_lock<std::mutex> guard{queues_mtx_};
+  // Drop queues of publishers and subscribers that no longer exist. Otherwise,
+  // their entries would remain until the next call to `register_queue`.
+  auto unused = [](const auto& x) { return x.second->unique(); };
+  queues_.erase(std::remove_if(queues_.begin(), queues_.end(), unused),
+                queues_.end());
+  result.reserve(queues_.size());
+  for (auto& [name, q] : queues_)
+    result.emplace_back(q->metrics(name));
   return result;
 }
 
+peer_metrics endpoint::peering_metrics() const {
+  peer_metrics result;
+  result.duplicates = stats_->duplicates.load(std::memory_order_relaxed);
+  result.blocked_bytes = stats_->blocked_bytes.load(std::memory_order_relaxed);
+  result.spilled_bytes = stats_->spilled_bytes.load(std::memory_order_relaxed);
+  return result;
+}
+
+void endpoint::register_queue(std::string name, detail::shared_queue_ptr<> q) {
+  std::unique_lock<std::mutex> guard{queues_mtx_};
+  // Drop queues that only the registry still refers to, i.e., queues of
+  // publishers and subscribers that no longer exist.
+  auto unused = [](const auto& x) { return x.second->unique(); };
+  queues_.erase(std::remove_if(queues_.begin(), queues_.end(), unused),
+                queues_.end());
+  queues_.emplace_back(std::move(name), std::move(q));
+}
+
 caf::actor endpoint::make_actor(actor_init_fun f) {
   auto hdl = system_.spawn([=](caf::event_based_actor* self) {
 #ifndef CAF_NO_EXCEPTION
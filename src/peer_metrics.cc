@@ -0,0 +1,15 @@
+#include "broker/peer_metrics.hh"
+
+namespace broker {
+
+std::string to_string(const peer_metrics& x) {
+  std::string result = "duplicates ";
+  result += std::to_string(x.duplicates);
+  result += ", blocked bytes ";
+  result += std::to_string(x.blocked_bytes);
+  result += ", spilled bytes ";
+  result += std::to_string(x.spilled_bytes);
+  return result;
+}
+
+} // namespace broker
@@ -1,7 +1,7 @@
 #include "broker/logger.hh" // Must come before any CAF include.
 #include "broker/publisher.hh"
 
-#include <numeric>
+#include <algorithm>
 
 #include <caf/attach_stream_source.hpp>
 #include <caf/send.hpp>
@@ -17,36 +17,10 @@ namespace broker {
 
 namespace {
 
-// TODO: make these constants configurable
-
-/// Defines how many seconds are averaged for the computation of the send rate.
-constexpr size_t sample_size = 10;
-
-/// Defines how many items are stored in the queue.
-constexpr size_t queue_size = 30;
-
 struct publisher_worker_state {
-  std::vector<size_t> buf;
-  size_t counter = 0;
   bool shutting_down = false;
 
   static const char* name;
-
-  void tick() {
-    if (buf.size() < sample_size) {
-      buf.push_back(counter);
-    } else {
-      std::rotate(buf.begin(), buf.begin() + 1, buf.end());
-      buf.back() = counter;
-    }
-    counter = 0;
-  }
-
-  size_t rate() {
-    return !buf.empty()
-           ? std::accumulate(buf.begin(), buf.end(), size_t{0}) / buf.size()
-           : 0;
-  }
 };
 
 const char* publisher_worker_state::name = "publisher_worker";
@@ -61,29 +35,18 @@ behavior publisher_worker(stateful_actor<publisher_worker_state>* self,
           // nop
         },
         [=](unit_t&, downstream<data_message>& out, size_t num) {
-          auto& st = self->state;
-          auto consumed = qptr->consume(
-            num, [&](data_message&& x) { out.push(std::move(x)); });
-          if (consumed > 0) {
-            st.counter += consumed;
-          }
+          qptr->consume(num, [&](data_message&& x) { out.push(std::move(x)); });
         },
         [=](const unit_t&) {
           return self->state.shutting_down && qptr->buffer_size() == 0;
         })
         .ptr();
-  //self->delayed_send(self, std::chrono::seconds(1), atom::tick_v);
   return {
     [=](atom::resume) {
+      qptr->clear_resume();
       if (handler->generate_messages())
         handler->push();
     },
-    [=](atom::tick) {
-      auto& st = self->state;
-      st.tick();
-      qptr->rate(st.rate());
-      self->delayed_send(self, std::chrono::seconds(1), atom::tick_v);
-    },
     [=](atom::shutdown) {
       self->state.shutting_down = true;
       self->unbecome();
@@ -96,12 +59,16 @@ behavior publisher_worker(stateful_actor<publisher_worker_state>* self,
 
 } // namespace <anonymous>
 
-publisher::publisher(endpoint& ep, topic t)
+publisher::publisher(endpoint& ep, topic t, size_t capacity,
+                     size_t max_capacity)
   : drop_on_destruction_(false),
-    queue_(detail::make_shared_publisher_queue(queue_size)),
+    queue_(detail::make_shared_publisher_queue(std::max(capacity, size_t{1}),
+                                               max_capacity)),
     worker_(ep.system().spawn(publisher_worker, &ep, queue_)),
     topic_(std::move(t)) {
-  // nop
+  // All messages of this publisher share the same topic. Interning it once
+  // turns each per-message topic copy into a pointer copy.
+  topic_.intern();
 }
 
 publisher::~publisher() {
@@ -124,6 +91,10 @@ size_t publisher::capacity() const {
   return queue_->capacity();
 }
 
+size_t publisher::max_capacity() const {
+  return std::max(queue_->capacity(), queue_->max_capacity());
+}
+
 size_t publisher::free_capacity() const {
   auto x = capacity();
   auto y = buffered();
@@ -131,7 +102,11 @@ size_t publisher::free_capacity() const {
 }
 
 size_t publisher::send_rate() const {
-  return static_cast<size_t>(queue_->rate());
+  return queue_->stats().dequeue_rate();
+}
+
+queue_metrics publisher::metrics() const {
+  return queue_->metrics("publisher " + topic_.string());
 }
 
 void publisher::drop_all_on_destruction() {
@@ -141,7 +116,7 @@ void publisher::drop_all_on_destruction() {
 void publisher::publish(data x) {
   BROKER_INFO("publishing" << std::make_pair(topic_, x));
   if (queue_->produce(topic_, std::move(x)))
-    anon_send(worker_, atom::resume_v);
+    wake_worker();
 }
 
 void publisher::publish(std::vector<data> xs) {
@@ -157,9 +132,14 @@ void publisher::publish(std::vector<data> xs) {
     }
 #endif
     if (queue_->produce(topic_, i, j))
-      anon_send(worker_, atom::resume_v);
+      wake_worker();
     i = j;
   }
 }
 
+void publisher::wake_worker() {
+  if (queue_->request_resume())
+    anon_send(worker_, atom::resume_v);
+}
+
 } // namespace broker
@@ -0,0 +1,26 @@
+#include "broker/queue_metrics.hh"
+
+namespace broker {
+
+std::string to_string(const queue_metrics& x) {
+  std::string result = x.name;
+  result += ": enqueued ";
+  result += std::to_string(x.enqueued);
+  result += ", dequeued ";
+  result += std::to_string(x.dequeued);
+  result += ", dropped ";
+  result += std::to_string(x.dropped);
+  result += ", buffered ";
+  result += std::to_string(x.buffered);
+  result += ", latency p50 ";
+  result += to_string(x.latency_p50);
+  result += ", p90 ";
+  result += to_string(x.latency_p90);
+  result += ", p99 ";
+  result += to_string(x.latency_p99);
+  result += ", max ";
+  result += to_string(x.latency_max);
+  return result;
+}
+
+} // namespace broker
@@ -0,0 +1,66 @@
+#include "broker/logger.hh" // Must come before any CAF include.
+#include "broker/sharded_subscriber.hh"
+
+#include <algorithm>
+#include <utility>
+
+#include <caf/send.hpp>
+
+#include "broker/atoms.hh"
+#include "broker/endpoint.hh"
+
+using namespace caf;
+
+namespace broker {
+
+sharded_subscriber::shard::shard(size_t max_qsize, queue_kind kind)
+  : super(static_cast<long>(max_qsize), kind) {
+  // nop
+}
+
+size_t sharded_subscriber::shard::dropped() const {
+  return queue_->dropped();
+}
+
+queue_metrics sharded_subscriber::shard::metrics() const {
+  return queue_->metrics("shard");
+}
+
+void sharded_subscriber::shard::became_not_full() {
+  if (queue_->request_resume())
+    anon_send(worker_, atom::resume_v);
+}
+
+sharded_subscriber::sharded_subscriber(endpoint& ep, std::vector<topic> ts,
+                                       size_t num_shards, shard_function f,
+                                       size_t max_qsize, queue_kind kind,
+                                       overflow_policy policy) {
+  BROKER_INFO("creating sharded subscriber for topic(s)"
+              << ts << "with" << num_shards << "shards");
+  num_shards = std::max(num_shards, size_t{1});
+  std::vector<detail::shared_subscriber_queue_ptr<>> queues;
+  shards_.reserve(num_shards);
+  queues.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(max_qsize, kind);
+    queues.emplace_back(shards_.back().queue_);
+  }
+  worker_ = detail::spawn_subscriber_worker(ep, std::move(queues),
+                                            std::move(f), std::move(ts),
+                                            max_qsize, policy);
+  for (auto& x : shards_)
+    x.worker_ = worker_;
+}
+
+sharded_subscriber::~sharded_subscriber() {
+  anon_send_exit(worker_, exit_reason::user_shutdown);
+}
+
+size_t sharded_subscriber::rate() const {
+  size_t result = 0;
+  for (auto& x : shards_)
+    result += x.queue_->stats().enqueue_rate();
+  return result;
+}
+
+} // namespace broker
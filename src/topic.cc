@@ -8,6 +8,13 @@ constexpr char topic::reserved[];
 
 std::vector<std::string> topic::split(const topic& t) {
   std::vector<std::string> result;
+  if (t.entry_ != nullptr) {
+    // Interned topics know their components already.
+    auto& str = t.entry_->str;
+    for (auto [offset, len] : t.entry_->segments)
+      result.emplace_back(str.substr(offset, len));
+    return result;
+  }
   std::string::size_type i = 0;
   while (i != std::string::npos) {
     auto j = t.str_.find(sep, i);
@@ -33,24 +40,55 @@ topic topic::join(const std::vector<std::string>& components) {
 }
 
 topic& topic::operator/=(const topic& rhs) {
-  if (!rhs.str_.empty() && rhs.str_[0] != sep && !str_.empty())
+  if (&rhs == this) {
+    auto copy = rhs;
+    return *this /= copy;
+  }
+  if (entry_ != nullptr) {
+    str_ = entry_->str;
+    entry_ = nullptr;
+  }
+  // Interned topics store their string in the intern table.
+  auto& suffix = rhs.string();
+  if (!suffix.empty() && suffix[0] != sep && !str_.empty())
     str_ += sep;
-  str_ += rhs.str_;
+  str_ += suffix;
   if (!str_.empty() && str_.back() == sep)
     str_.pop_back();
   return *this;
 }
 
 const std::string& topic::string() const {
-  return str_;
+  return entry_ != nullptr ? entry_->str : str_;
 }
 
 bool topic::prefix_of(const topic& t) const {
-  return str_.size() <= t.str_.size()
-         && t.str_.compare(0, str_.size(), str_) == 0;
+  if (entry_ != nullptr && entry_ == t.entry_)
+    return true;
+  auto& x = string();
+  auto& y = t.string();
+  return x.size() <= y.size() && y.compare(0, x.size(), x) == 0;
+}
+
+bool topic::intern() {
+  if (entry_ != nullptr)
+    return true;
+  entry_ = detail::topic_intern_table::instance().intern(str_);
+  if (entry_ == nullptr)
+    return false;
+  std::string{}.swap(str_);
+  return true;
+}
+
+size_t topic::hash() const noexcept {
+  if (entry_ != nullptr)
+    return entry_->hash;
+  return std::hash<std::string>{}(str_);
 }
 
 bool operator==(const topic& lhs, const topic& rhs) {
+  if (auto x = lhs.id(), y = rhs.id(); x != 0 && y != 0)
+    return x == y;
   return lhs.string() == rhs.string();
 }
 
@@ -0,0 +1,159 @@
+// Measures how fast Broker can dispatch the data messages of a generator file
+// to a set of subscribers. Compares the downstream manager of CAF, which checks
+// each message against each path, with the indexed downstream manager of
+// Broker, which looks up the paths once per run of consecutive messages that
+// share the same topic and moves messages into the last receiver.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <caf/broadcast_downstream_manager.hpp>
+#include <caf/outbound_path.hpp>
+
+#include "broker/detail/generator_file_reader.hh"
+#include "broker/detail/indexed_downstream_manager.hh"
+#include "broker/detail/prefix_matcher.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+using value_type = detail::generator_file_reader::value_type;
+
+using message_list = std::vector<data_message>;
+
+using broadcast_manager
+  = caf::broadcast_downstream_manager<data_message, filter_type,
+                                      detail::prefix_matcher>;
+
+using indexed_manager
+  = detail::indexed_downstream_manager<data_message, filter_type,
+                                       detail::prefix_matcher>;
+
+// Adds one path per subscriber and spreads the topics over all paths.
+template <class Manager>
+void add_paths(Manager& mgr, const std::vector<topic>& topics,
+               size_t num_subscribers) {
+  for (size_t i = 0; i < num_subscribers; ++i) {
+    auto slot = static_cast<caf::stream_slot>(i + 1);
+    mgr.insert_path(std::make_unique<caf::outbound_path>(slot, nullptr));
+    mgr.set_filter(slot, filter_type{topics[i % topics.size()]});
+  }
+}
+
+// Fills the central buffer of `mgr`, dispatches all messages to the buffers
+// of the paths and returns how many messages the paths received.
+template <class Manager>
+size_t dispatch(Manager& mgr, const message_list& xs) {
+  auto& buf = mgr.buf();
+  buf.insert(buf.end(), xs.begin(), xs.end());
+  mgr.fan_out_flush();
+  size_t result = 0;
+  for (auto& kvp : mgr.states().container()) {
+    result += kvp.second.buf.size();
+    kvp.second.buf.clear();
+  }
+  return result;
+}
+
+template <class F>
+double measure(size_t rounds, size_t& checksum, F f) {
+  auto t0 = clock_type::now();
+  for (size_t i = 0; i < rounds; ++i)
+    checksum += f();
+  auto t1 = clock_type::now();
+  return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void usage(const char* program) {
+  std::cerr << "usage: " << program
+            << " [GENERATOR_FILE] [NUM_SUBSCRIBERS] [ROUNDS]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 4) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::string file_name = argc > 1 ? argv[1] : "mars.dat";
+  size_t num_subscribers = 8;
+  size_t rounds = 100;
+  try {
+    if (argc > 2)
+      num_subscribers = std::stoul(argv[2]);
+    if (argc > 3)
+      rounds = std::stoul(argv[3]);
+  } catch (std::exception&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  // Read all messages from the generator file.
+  auto gptr = detail::make_generator_file_reader(file_name);
+  if (gptr == nullptr) {
+    std::cerr << "unable to open " << file_name << " as generator file"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  message_list xs;
+  while (!gptr->at_end()) {
+    value_type x;
+    if (auto err = gptr->read(x)) {
+      std::cerr << "error while reading the generator file: " << to_string(err)
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    // Only workers receive data messages. Stores have their own manager.
+    if (auto msg = caf::get_if<data_message>(&x))
+      xs.emplace_back(std::move(*msg));
+  }
+  auto& topics = gptr->topics();
+  if (xs.empty() || topics.empty()) {
+    std::cerr << file_name << " contains no data messages" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // Spread the topics of the file over all subscribers.
+  broadcast_manager per_path_mgr{nullptr};
+  add_paths(per_path_mgr, topics, num_subscribers);
+  indexed_manager indexed_mgr{nullptr};
+  add_paths(indexed_mgr, topics, num_subscribers);
+  // Print some statistics on the input.
+  size_t num_runs = 1;
+  for (size_t i = 1; i < xs.size(); ++i)
+    if (get_topic(xs[i]) != get_topic(xs[i - 1]))
+      ++num_runs;
+  std::cout << "messages: " << xs.size() << '\n'
+            << "topics: " << topics.size() << '\n'
+            << "runs: " << num_runs << " (avg. length: "
+            << static_cast<double>(xs.size()) / num_runs << ")\n"
+            << "subscribers: " << num_subscribers << '\n'
+            << "rounds: " << rounds << std::endl;
+  // Run the benchmark.
+  size_t checksum1 = 0;
+  size_t checksum2 = 0;
+  auto per_path = measure(rounds, checksum1, [&] {
+    return dispatch(per_path_mgr, xs);
+  });
+  auto indexed = measure(rounds, checksum2, [&] {
+    return dispatch(indexed_mgr, xs);
+  });
+  if (checksum1 != checksum2) {
+    std::cerr << "checksum mismatch: " << checksum1 << " != " << checksum2
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "per path: " << per_path << " ms\n"
+            << "indexed: " << indexed << " ms\n"
+            << "speedup: " << per_path / indexed << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+// Measures the throughput of the queue between a subscriber and its background
+// worker. Compares the mutex-based and the lock-free subscriber queue with the
+// single-producer, single-consumer queues by Cameron Desrochers.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "readerwriterqueue/readerwriterqueue.h"
+
+#include "broker/data.hh"
+#include "broker/detail/shared_subscriber_queue.hh"
+#include "broker/message.hh"
+#include "broker/queue_kind.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+  size_t num_messages = 1000000;
+  size_t batch_size = 50;
+  data_message prototype = make_data_message(topic{"/benchmark/queue"},
+                                             data{"hello world"});
+};
+
+// Runs `produce` and `consume` in two threads and returns the elapsed time.
+template <class Producer, class Consumer>
+double measure(Producer produce, Consumer consume) {
+  auto t0 = clock_type::now();
+  std::thread producer{produce};
+  consume();
+  producer.join();
+  auto t1 = clock_type::now();
+  return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Produces batches like the subscriber worker and consumes them like
+// `subscriber_base::get`.
+double run_subscriber_queue(const config& cfg, queue_kind kind) {
+  auto q = detail::make_shared_subscriber_queue<data_message>(kind);
+  return measure(
+    [&] {
+      std::vector<data_message> batch;
+      for (size_t i = 0; i < cfg.num_messages; i += cfg.batch_size) {
+        batch.assign(std::min(cfg.batch_size, cfg.num_messages - i),
+                     cfg.prototype);
+        q->produce(batch.size(), std::make_move_iterator(batch.begin()),
+                   std::make_move_iterator(batch.end()));
+      }
+    },
+    [&] {
+      size_t received = 0;
+      auto f = [&received](data_message&&) { ++received; };
+      while (received < cfg.num_messages) {
+        q->wait_on_flare();
+        q->consume(cfg.batch_size, nullptr, f);
+      }
+    });
+}
+
+// Passes messages individually through a blocking queue.
+double run_blocking_rwq(const config& cfg) {
+  moodycamel::BlockingReaderWriterQueue<data_message> q{cfg.batch_size};
+  return measure(
+    [&] {
+      for (size_t i = 0; i < cfg.num_messages; ++i)
+        q.enqueue(cfg.prototype);
+    },
+    [&] {
+      data_message x;
+      for (size_t i = 0; i < cfg.num_messages; ++i)
+        q.wait_dequeue(x);
+    });
+}
+
+// Passes messages individually through a queue without blocking.
+double run_spinning_rwq(const config& cfg) {
+  moodycamel::ReaderWriterQueue<data_message> q{cfg.batch_size};
+  return measure(
+    [&] {
+      for (size_t i = 0; i < cfg.num_messages; ++i)
+        q.enqueue(cfg.prototype);
+    },
+    [&] {
+      data_message x;
+      for (size_t i = 0; i < cfg.num_messages;)
+        if (q.try_dequeue(x))
+          ++i;
+    });
+}
+
+void usage(const char* program) {
+  std::cerr << "usage: " << program << " [NUM_MESSAGES] [BATCH_SIZE]"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  config cfg;
+  try {
+    if (argc > 1)
+      cfg.num_messages = std::stoul(argv[1]);
+    if (argc > 2)
+      cfg.batch_size = std::stoul(argv[2]);
+  } catch (std::exception&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (cfg.num_messages == 0 || cfg.batch_size == 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::cout << "messages: " << cfg.num_messages << '\n'
+            << "batch size: " << cfg.batch_size << std::endl;
+  auto print = [&](const char* name, double ms) {
+    std::cout << name << ": " << ms << " ms ("
+              << static_cast<size_t>(cfg.num_messages / ms * 1000)
+              << " msg/s)" << std::endl;
+  };
+  print("subscriber queue (locked)",
+        run_subscriber_queue(cfg, queue_kind::locked));
+  print("subscriber queue (lock-free)",
+        run_subscriber_queue(cfg, queue_kind::lock_free));
+  print("BlockingReaderWriterQueue", run_blocking_rwq(cfg));
+  print("ReaderWriterQueue (spinning)", run_spinning_rwq(cfg));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+// Measures how long clones take for computing the store events when applying
+// a snapshot to a non-empty store. Compares the hashed merge in
+// `detail::diff_snapshots` with the previous algorithm that checked each key
+// of the snapshot against a list of all existing keys. Also measures streamed
+// snapshots, which clones apply one entry at a time, with the stale keys
+// tracked as copies or as pointers into the store.
+//
+// Each run starts with a store of N keys. The snapshot removes 10% of these
+// keys, updates the remaining keys and adds 10% new keys.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/detail/diff_snapshots.hh"
+#include "broker/snapshot.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct event_counts {
+  size_t erased = 0;
+  size_t updated = 0;
+  size_t inserted = 0;
+
+  size_t total() const {
+    return erased + updated + inserted;
+  }
+};
+
+// Generates a store with `n` keys and a snapshot of its next state.
+std::pair<snapshot, snapshot> make_states(size_t n) {
+  snapshot old_state;
+  snapshot new_state;
+  old_state.reserve(n);
+  new_state.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto key = data{"key-" + std::to_string(i)};
+    old_state.emplace(key, data{static_cast<count>(i)});
+    if (i % 10 != 0)
+      new_state.emplace(std::move(key), data{static_cast<count>(i + 1)});
+  }
+  for (size_t i = n; i < n + n / 10; ++i)
+    new_state.emplace(data{"key-" + std::to_string(i)},
+                      data{static_cast<count>(i)});
+  return {std::move(old_state), std::move(new_state)};
+}
+
+event_counts hashed_merge(const snapshot& store, const snapshot& state) {
+  event_counts result;
+  detail::diff_snapshots(
+    store, state, [&](const data&) { ++result.erased; },
+    [&](const data&, const data&, const data&) { ++result.updated; },
+    [&](const data&, const data&) { ++result.inserted; });
+  return result;
+}
+
+// The algorithm of clone_state::operator()(set_command&) before switching to
+// `detail::diff_snapshots`.
+event_counts linear_scan(const snapshot& store, snapshot& state) {
+  event_counts result;
+  std::vector<const data*> keys;
+  keys.reserve(store.size());
+  for (auto& kvp : store)
+    keys.emplace_back(&kvp.first);
+  auto is_erased = [&state](const data* key) {
+    return state.count(*key) == 0;
+  };
+  auto p = std::partition(keys.begin(), keys.end(), is_erased);
+  result.erased = static_cast<size_t>(p - keys.begin());
+  for (auto i = p; i != keys.end(); ++i) {
+    const auto& value = state[**i];
+    static_cast<void>(value);
+    ++result.updated;
+  }
+  auto is_new = [&keys](const data& key) {
+    for (const auto key_ptr : keys)
+      if (*key_ptr == key)
+        return false;
+    return true;
+  };
+  for (const auto& kvp : state)
+    if (is_new(kvp.first))
+      ++result.inserted;
+  return result;
+}
+
+const data& key_of(const data& key) {
+  return key;
+}
+
+const data& key_of(const data* key) {
+  return *key;
+}
+
+// Applies `state` to `store` one entry at a time and erases all keys that
+// `state` did not contain at the end, like clone_state does for streamed
+// snapshots. `StaleKeys` stores either copies of the keys or pointers to them.
+template <class StaleKeys, class ToStaleKey>
+event_counts streamed(snapshot& store, const snapshot& state, ToStaleKey f) {
+  event_counts result;
+  StaleKeys stale_keys;
+  stale_keys.reserve(store.size());
+  for (auto& kvp : store)
+    stale_keys.emplace(f(kvp.first));
+  for (auto& kvp : state) {
+    // Clones receive each entry as a new object.
+    auto key = kvp.first;
+    auto value = kvp.second;
+    if (auto i = store.find(key); i != store.end()) {
+      stale_keys.erase(f(i->first));
+      i->second = std::move(value);
+      ++result.updated;
+    } else {
+      store.emplace(std::move(key), std::move(value));
+      ++result.inserted;
+    }
+  }
+  for (auto& key : stale_keys) {
+    store.erase(store.find(key_of(key)));
+    ++result.erased;
+  }
+  return result;
+}
+
+event_counts streamed_key_copies(snapshot& store, const snapshot& state) {
+  return streamed<std::unordered_set<data>>(
+    store, state, [](const data& key) -> const data& { return key; });
+}
+
+event_counts streamed_key_pointers(snapshot& store, const snapshot& state) {
+  return streamed<std::unordered_set<const data*>>(
+    store, state, [](const data& key) { return &key; });
+}
+
+template <class F>
+void run(const char* label, size_t n, F f) {
+  auto [store, state] = make_states(n);
+  auto t0 = clock_type::now();
+  auto counts = f(store, state);
+  auto t1 = clock_type::now();
+  auto ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  std::cout << label << ": " << n << " keys, " << ms << " ms, "
+            << counts.erased << " erased, " << counts.updated << " updated, "
+            << counts.inserted << " inserted, "
+            << static_cast<size_t>(counts.total() / (ms / 1000.0))
+            << " events/s" << std::endl;
+}
+
+void usage(const char* argv0) {
+  std::cerr << "usage: " << argv0 << " [MAX_KEYS [MAX_KEYS_LINEAR_SCAN]]"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  size_t max_keys = 10000000;
+  size_t max_keys_linear_scan = 10000;
+  try {
+    if (argc > 1)
+      max_keys = std::stoul(argv[1]);
+    if (argc > 2)
+      max_keys_linear_scan = std::stoul(argv[2]);
+  } catch (std::exception&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (size_t n = 10000; n <= max_keys; n *= 10) {
+    run("hashed merge", n, hashed_merge);
+    run("streamed, key copies", n, streamed_key_copies);
+    run("streamed, key pointers", n, streamed_key_pointers);
+    if (n <= max_keys_linear_scan)
+      run("linear scan", n, linear_scan);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Measures the latency and CPU time of `subscriber_base::get` for messages that
+// arrive at a fixed interval. Compares blocking on the flare with spinning on
+// the queue before blocking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#include "broker/data.hh"
+#include "broker/message.hh"
+#include "broker/subscriber_base.hh"
+#include "broker/time.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+  size_t num_messages = 100000;
+  timespan interval = std::chrono::microseconds(10);
+  timespan spin_budget = std::chrono::microseconds(50);
+};
+
+// Gives the benchmark access to the queue of the subscriber.
+class bench_subscriber : public subscriber_base<data_message> {
+public:
+  using super = subscriber_base<data_message>;
+
+  bench_subscriber() : super(std::numeric_limits<long>::max()) {
+    // nop
+  }
+
+  queue_ptr& queue() {
+    return queue_;
+  }
+};
+
+// Returns the CPU time of the calling thread in milliseconds.
+double thread_cpu_ms() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+count now_ns() {
+  auto t = clock_type::now().time_since_epoch();
+  return static_cast<count>(std::chrono::nanoseconds{t}.count());
+}
+
+// Sends messages with the current time at a fixed interval and returns the
+// latency of each message on the receiver side. Stores the CPU time of the
+// receiving thread in `cpu_ms`.
+std::vector<double> run(const config& cfg, timespan spin_budget,
+                        double& cpu_ms) {
+  bench_subscriber sub;
+  sub.spin_budget(spin_budget);
+  auto q = sub.queue();
+  std::vector<double> latencies;
+  latencies.reserve(cfg.num_messages);
+  auto cpu0 = thread_cpu_ms();
+  std::thread producer{[&] {
+    auto next = clock_type::now();
+    for (size_t i = 0; i < cfg.num_messages; ++i) {
+      next += cfg.interval;
+      while (clock_type::now() < next)
+        ; // Busy wait to get intervals below the scheduler granularity.
+      q->produce(make_data_message(topic{"/benchmark/wait"}, data{now_ns()}));
+    }
+  }};
+  for (size_t i = 0; i < cfg.num_messages; ++i) {
+    auto x = sub.get();
+    auto sent = caf::get<count>(get_data(x));
+    latencies.emplace_back((now_ns() - sent) / 1000.0);
+  }
+  cpu_ms = thread_cpu_ms() - cpu0;
+  producer.join();
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+void print(const char* name, const std::vector<double>& xs, double cpu_ms) {
+  auto percentile = [&](double p) {
+    return xs[std::min(xs.size() - 1, static_cast<size_t>(xs.size() * p))];
+  };
+  double sum = 0;
+  for (auto x : xs)
+    sum += x;
+  std::cout << name << ":\n"
+            << "  avg latency: " << sum / xs.size() << " us\n"
+            << "  p50 latency: " << percentile(0.5) << " us\n"
+            << "  p99 latency: " << percentile(0.99) << " us\n"
+            << "  CPU time (receiver): " << cpu_ms << " ms" << std::endl;
+}
+
+void usage(const char* program) {
+  std::cerr << "usage: " << program
+            << " [NUM_MESSAGES] [INTERVAL_US] [SPIN_BUDGET_US]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 4) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  config cfg;
+  try {
+    if (argc > 1)
+      cfg.num_messages = std::stoul(argv[1]);
+    if (argc > 2)
+      cfg.interval = std::chrono::microseconds(std::stoul(argv[2]));
+    if (argc > 3)
+      cfg.spin_budget = std::chrono::microseconds(std::stoul(argv[3]));
+  } catch (std::exception&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (cfg.num_messages == 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::cout << "messages: " << cfg.num_messages << '\n'
+            << "interval: " << to_string(cfg.interval) << '\n'
+            << "spin budget: " << to_string(cfg.spin_budget) << std::endl;
+  double cpu_ms = 0;
+  auto blocking = run(cfg, timespan{0}, cpu_ms);
+  print("blocking", blocking, cpu_ms);
+  auto spinning = run(cfg, cfg.spin_budget, cpu_ms);
+  print("spin-then-block", spinning, cpu_ms);
+  return EXIT_SUCCESS;
+}
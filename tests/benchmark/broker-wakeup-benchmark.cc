@@ -0,0 +1,177 @@
+// Measures how many resume messages a publisher sends to its background worker
+// under bursty load. Compares sending a resume message whenever the queue
+// becomes non-empty with coalescing resume messages via the pending flag of
+// the shared queue.
+//
+// The worker runs on its own thread with a minimal mailbox. Just like the
+// stream source of the actual publisher worker, it pulls messages out of the
+// queue on resume messages as well as on credit from its downstream.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "broker/data.hh"
+#include "broker/detail/shared_publisher_queue.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+  size_t num_messages = 1000000;
+  size_t burst_size = 16;
+  size_t capacity = 128;
+  size_t credit = 64;
+};
+
+enum class msg_type { resume, credit, stop };
+
+struct msg {
+  msg_type type;
+  size_t amount;
+};
+
+// Minimal stand-in for an actor mailbox.
+class mailbox {
+public:
+  void push(msg x) {
+    {
+      std::unique_lock<std::mutex> guard{mtx_};
+      xs_.push_back(x);
+    }
+    cv_.notify_one();
+  }
+
+  msg pop() {
+    std::unique_lock<std::mutex> guard{mtx_};
+    cv_.wait(guard, [this] { return !xs_.empty(); });
+    auto x = xs_.front();
+    xs_.pop_front();
+    return x;
+  }
+
+private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<msg> xs_;
+};
+
+struct result {
+  double ms = 0;
+  size_t resumes = 0;
+  size_t credits = 0;
+};
+
+result run(const config& cfg, bool coalesce) {
+  auto q = detail::make_shared_publisher_queue(cfg.capacity);
+  mailbox worker_box;
+  mailbox downstream_box;
+  result res;
+  // Receives batches from the worker and returns credit for them.
+  std::thread downstream{[&] {
+    for (;;) {
+      auto x = downstream_box.pop();
+      if (x.type == msg_type::stop)
+        return;
+      worker_box.push(msg{msg_type::credit, x.amount});
+    }
+  }};
+  // Ships messages from the queue to the downstream as credit permits.
+  std::thread worker{[&] {
+    size_t credit = cfg.credit;
+    size_t received = 0;
+    while (received < cfg.num_messages) {
+      auto x = worker_box.pop();
+      if (x.type == msg_type::resume) {
+        if (coalesce)
+          q->clear_resume();
+        ++res.resumes;
+      } else {
+        credit += x.amount;
+        ++res.credits;
+      }
+      if (credit == 0)
+        continue;
+      auto n = q->consume(credit, [](data_message&&) {});
+      if (n > 0) {
+        credit -= n;
+        received += n;
+        downstream_box.push(msg{msg_type::credit, n});
+      }
+    }
+    downstream_box.push(msg{msg_type::stop, 0});
+  }};
+  topic t{"/benchmark/wakeup"};
+  auto t0 = clock_type::now();
+  for (size_t i = 0; i < cfg.num_messages; ++i) {
+    if (q->produce(t, data{static_cast<count>(i)})
+        && (!coalesce || q->request_resume()))
+      worker_box.push(msg{msg_type::resume, 0});
+    if ((i + 1) % cfg.burst_size == 0)
+      std::this_thread::yield();
+  }
+  worker.join();
+  auto t1 = clock_type::now();
+  downstream.join();
+  res.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  return res;
+}
+
+void print(const config& cfg, const char* label, const result& res) {
+  auto rate = cfg.num_messages / (res.ms / 1000.0);
+  std::cout << label << ": " << res.ms << " ms, "
+            << static_cast<size_t>(rate) << " msg/s, " << res.resumes
+            << " resume messages, " << res.resumes + res.credits
+            << " mailbox messages" << std::endl;
+}
+
+void usage(const char* argv0) {
+  std::cerr << "usage: " << argv0
+            << " [NUM_MESSAGES [BURST_SIZE [CAPACITY [CREDIT]]]]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 5) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  config cfg;
+  try {
+    if (argc > 1)
+      cfg.num_messages = std::stoul(argv[1]);
+    if (argc > 2)
+      cfg.burst_size = std::stoul(argv[2]);
+    if (argc > 3)
+      cfg.capacity = std::stoul(argv[3]);
+    if (argc > 4)
+      cfg.credit = std::stoul(argv[4]);
+  } catch (std::exception&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (cfg.num_messages == 0 || cfg.burst_size == 0 || cfg.capacity == 0
+      || cfg.credit == 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::cout << "messages: " << cfg.num_messages << '\n'
+            << "burst size: " << cfg.burst_size << '\n'
+            << "capacity: " << cfg.capacity << '\n'
+            << "credit: " << cfg.credit << std::endl;
+  print(cfg, "resume per wakeup", run(cfg, false));
+  print(cfg, "coalesced resumes", run(cfg, true));
+  return EXIT_SUCCESS;
+}
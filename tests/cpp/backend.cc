@@ -12,6 +12,7 @@
 #include <set>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -27,6 +28,7 @@
 #include "broker/detail/sqlite_backend.hh"
 #include "broker/error.hh"
 #include "broker/expected.hh"
+#include "broker/internal_command.hh"
 #include "broker/optional.hh"
 #include "broker/snapshot.hh"
 #include "broker/time.hh"
@@ -114,6 +116,22 @@ public:
     );
   }
 
+  expected<void> begin_batch() override {
+    return perform<void>(
+      [](detail::abstract_backend& backend) {
+        return backend.begin_batch();
+      }
+    );
+  }
+
+  expected<void> commit_batch() override {
+    return perform<void>(
+      [](detail::abstract_backend& backend) {
+        return backend.commit_batch();
+      }
+    );
+  }
+
   expected<data> get(const data& key) const override {
     return perform<data>(
       [&](detail::abstract_backend& backend) {
@@ -162,6 +180,45 @@ public:
     );
   }
 
+  detail::backend_cursor_ptr scan() const override {
+    // Backends visit their keys in different orders. Hence, we collect all
+    // entries, sort them and then compare the results.
+    using entry_tuple = std::tuple<data, data, optional<timestamp>>;
+    std::vector<expected<std::vector<entry_tuple>>> xs;
+    for (auto& backend : backends_) {
+      std::vector<entry_tuple> entries;
+      detail::scan_entries buf;
+      auto cursor = backend->scan();
+      auto res = cursor->next(buf, 3);
+      for (; res && !buf.empty(); res = cursor->next(buf, 3)) {
+        if (buf.size() > 3) {
+          res = make_error(ec::unspecified, "cursor exceeded batch size");
+          break;
+        }
+        for (auto& x : buf)
+          entries.emplace_back(x.key, x.value, x.expiry);
+      }
+      if (!res) {
+        xs.emplace_back(res.error());
+        continue;
+      }
+      std::sort(entries.begin(), entries.end(),
+                [](const entry_tuple& x, const entry_tuple& y) {
+                  return std::get<0>(x) < std::get<0>(y);
+                });
+      xs.emplace_back(std::move(entries));
+    }
+    auto result = std::make_unique<fixed_cursor>();
+    if (!all_equal(xs))
+      result->err = make_error(ec::unspecified, "backends disagree on scan");
+    else if (!xs.front())
+      result->err = xs.front().error();
+    else
+      for (auto& [key, value, expiry] : *xs.front())
+        result->entries.emplace_back(detail::scan_entry{key, value, expiry});
+    return result;
+  }
+
   expected<broker::detail::expirables> expiries() const override {
     return perform<broker::detail::expirables>(
       [](detail::abstract_backend& backend) {
@@ -171,6 +228,22 @@ public:
   }
 
 private:
+  /// Replays previously collected entries.
+  struct fixed_cursor : detail::backend_cursor {
+    expected<void> next(detail::scan_entries& out, size_t n) override {
+      out.clear();
+      if (err)
+        return err;
+      for (; pos < entries.size() && out.size() < n; ++pos)
+        out.emplace_back(entries[pos]);
+      return {};
+    }
+
+    error err;
+    detail::scan_entries entries;
+    size_t pos = 0;
+  };
+
   template <class T, class F>
   expected<T> perform(F f) {
     std::vector<expected<T>> xs;
@@ -349,4 +422,127 @@ TEST(size/snapshot) {
   CHECK_EQUAL(ss->count("foo"), 1u);
 }
 
+TEST(scan) {
+  using namespace std::chrono;
+  auto expiry = broker::now() + seconds{42};
+  for (integer i = 0; i < 20; ++i)
+    RUN(backend->put(i, i * 2, i % 2 == 0 ? optional<timestamp>{expiry}
+                                         : optional<timestamp>{}));
+  auto cursor = backend->scan();
+  detail::scan_entries buf;
+  std::set<data> keys;
+  do {
+    RUN(cursor->next(buf, 8));
+    CHECK_LESS_EQUAL(buf.size(), 8u);
+    for (auto& x : buf) {
+      keys.emplace(x.key);
+      auto i = caf::get<integer>(x.key);
+      CHECK_EQUAL(x.value, data{i * 2});
+      CHECK_EQUAL(static_cast<bool>(x.expiry), i % 2 == 0);
+    }
+  } while (!buf.empty());
+  CHECK_EQUAL(keys.size(), 20u);
+  MESSAGE("keys and snapshot use scan");
+  CHECK_EQUAL(RUN(backend->keys()), data{keys});
+  CHECK_EQUAL(RUN(backend->snapshot()).size(), 20u);
+}
+
+TEST(scan while modifying the backend) {
+  // Note: `backend` refers to the member of the fixture in this scope.
+  std::vector<broker::backend> kinds{broker::backend::memory,
+                                     broker::backend::sqlite};
+#ifdef BROKER_HAVE_ROCKSDB
+  kinds.emplace_back(broker::backend::rocksdb);
+#endif
+  for (auto kind : kinds) {
+    auto path = detail::make_temp_file_name();
+    auto opts = backend_options{{"path", path}};
+    auto bp = detail::make_backend(kind, std::move(opts));
+    for (integer i = 0; i < 100; ++i)
+      RUN(bp->put(i, i));
+    auto cursor = bp->scan();
+    detail::scan_entries buf;
+    std::set<data> keys;
+    RUN(cursor->next(buf, 10));
+    CHECK_EQUAL(buf.size(), 10u);
+    for (auto& x : buf)
+      keys.emplace(x.key);
+    MESSAGE("grow the store after the first batch");
+    for (integer i = 100; i < 1000; ++i)
+      RUN(bp->put(i, i));
+    do {
+      RUN(cursor->next(buf, 10));
+      for (auto& x : buf)
+        keys.emplace(x.key);
+    } while (!buf.empty());
+    for (integer i = 0; i < 100; ++i)
+      CHECK_EQUAL(keys.count(data{i}), 1u);
+    bp.reset();
+    detail::remove_all(path);
+  }
+}
+
+TEST(memory cursors visit each key once even if the table rehashes) {
+  auto bp = detail::make_backend(broker::backend::memory, backend_options{});
+  for (integer i = 0; i < 100; ++i)
+    RUN(bp->put(i, i));
+  auto cursor = bp->scan();
+  detail::scan_entries buf;
+  std::multiset<data> keys;
+  RUN(cursor->next(buf, 10));
+  for (auto& x : buf)
+    keys.emplace(x.key);
+  MESSAGE("grow the store to force a rehash and erase a key not visited yet");
+  std::set<data> erased;
+  for (integer i = 0; i < 100; ++i)
+    if (keys.count(data{i}) == 0) {
+      RUN(bp->erase(i));
+      erased.emplace(i);
+      break;
+    }
+  for (integer i = 100; i < 10000; ++i)
+    RUN(bp->put(i, i));
+  do {
+    RUN(cursor->next(buf, 10));
+    for (auto& x : buf)
+      keys.emplace(x.key);
+  } while (!buf.empty());
+  CHECK_EQUAL(keys.size(), 99u);
+  for (integer i = 0; i < 100; ++i)
+    CHECK_EQUAL(keys.count(data{i}), erased.count(data{i}) == 0 ? 1u : 0u);
+}
+
+TEST(apply_batch) {
+  RUN(backend->put("foo", 1));
+  std::vector<internal_command> cmds;
+  cmds.emplace_back(make_internal_command<put_command>("bar", 2, nil,
+                                                       publisher_id{}));
+  cmds.emplace_back(make_internal_command<add_command>(
+    "bar", 40, data::type::integer, nil, publisher_id{}));
+  cmds.emplace_back(make_internal_command<erase_command>("foo",
+                                                         publisher_id{}));
+  cmds.emplace_back(make_internal_command<put_command>("baz", 3, nil,
+                                                       publisher_id{}));
+  size_t calls = 0;
+  auto apply = [&](internal_command& cmd) {
+    ++calls;
+    if (auto x = caf::get_if<put_command>(&cmd.content)) {
+      RUN(backend->put(x->key, x->value));
+    } else if (auto x = caf::get_if<add_command>(&cmd.content)) {
+      MESSAGE("lookups see previous changes of the batch");
+      CHECK_EQUAL(RUN(backend->get(x->key)), data{2});
+      RUN(backend->add(x->key, x->value, x->init_type));
+    } else if (auto x = caf::get_if<erase_command>(&cmd.content)) {
+      RUN(backend->erase(x->key));
+      CHECK_EQUAL(RUN(backend->exists(x->key)), false);
+    }
+  };
+  RUN(backend->apply_batch(caf::make_span(cmds), apply));
+  CHECK_EQUAL(calls, 4u);
+  CHECK_EQUAL(RUN(backend->get("bar")), data{42});
+  CHECK_EQUAL(RUN(backend->get("baz")), data{3});
+  CHECK_EQUAL(RUN(backend->exists("foo")), false);
+  CHECK_EQUAL(RUN(backend->size()), 2u);
+}
+
 FIXTURE_SCOPE_END()
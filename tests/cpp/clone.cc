@@ -0,0 +1,458 @@
+#define SUITE clone
+
+#include "broker/detail/clone_actor.hh"
+
+#include "test.hh"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <caf/attach_stream_source.hpp>
+
+#include "broker/backend.hh"
+#include "broker/backend_options.hh"
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/detail/make_backend.hh"
+#include "broker/detail/master_actor.hh"
+#include "broker/internal_command.hh"
+#include "broker/message.hh"
+#include "broker/store_event.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+struct fake_core_state {
+  /// Sequence numbers of all snapshot requests from the clone.
+  std::vector<uint64_t> snapshot_requests;
+
+  static inline const char* name = "fake_core";
+};
+
+// Records snapshot requests and drops everything else, e.g., store events.
+caf::behavior fake_core(caf::stateful_actor<fake_core_state>* self) {
+  self->set_default_handler(caf::drop);
+  return {
+    [=](atom::store, atom::master, atom::snapshot, const std::string&,
+        const caf::actor&, uint64_t seq) {
+      self->state.snapshot_requests.emplace_back(seq);
+    },
+  };
+}
+
+caf::behavior fake_master(caf::event_based_actor* self) {
+  self->set_default_handler(caf::drop);
+  return {
+    [](atom::ok) {
+      // nop
+    },
+  };
+}
+
+template <class T>
+struct source_state {
+  std::deque<T> xs;
+  bool done = false;
+  static inline const char* name = "source";
+};
+
+// Streams all elements that it receives to `sink` until receiving 'ok'.
+template <class T>
+caf::behavior source(caf::stateful_actor<source_state<T>>* self,
+                     const caf::actor& sink) {
+  auto mgr
+    = attach_stream_source(
+        self, sink,
+        [](caf::unit_t&) {
+          // nop
+        },
+        [=](caf::unit_t&, caf::downstream<T>& out, size_t num) {
+          auto& xs = self->state.xs;
+          for (; num > 0 && !xs.empty(); --num) {
+            out.push(std::move(xs.front()));
+            xs.pop_front();
+          }
+        },
+        [=](const caf::unit_t&) {
+          return self->state.done && self->state.xs.empty();
+        })
+        .ptr();
+  return {
+    [=](T& x) {
+      self->state.xs.emplace_back(std::move(x));
+      mgr->push();
+    },
+    [=](atom::ok) {
+      self->state.done = true;
+      mgr->push();
+    },
+  };
+}
+
+struct router_state {
+  caf::actor master;
+
+  caf::actor clone;
+
+  /// Streams the commands of the master to the clone.
+  caf::actor updates;
+
+  /// Drops all traffic between master and clone while `false`.
+  bool connected = true;
+
+  /// Sequence numbers of all snapshot requests from the clone.
+  std::vector<uint64_t> snapshot_requests;
+
+  /// Store events of the clone.
+  std::vector<std::string> clone_events;
+
+  static inline const char* name = "router";
+};
+
+// Connects a master and a clone like the cores of two peered endpoints.
+caf::behavior router(caf::stateful_actor<router_state>* self) {
+  self->set_default_handler(caf::drop);
+  return {
+    [=](atom::publish, command_message& msg, node_message_flags) {
+      if (self->state.connected)
+        self->send(self->state.updates, std::move(msg));
+    },
+    [=](atom::publish, atom::local, data_message& msg) {
+      if (caf::actor_cast<caf::actor>(self->current_sender())
+          != self->state.clone)
+        return;
+      auto& events = self->state.clone_events;
+      auto& content = get_data(msg);
+      if (auto ins = store_event::insert::make(content))
+        events.emplace_back("insert " + to_string(ins.key()));
+      else if (auto upd = store_event::update::make(content))
+        events.emplace_back("update " + to_string(upd.key()));
+      else if (auto del = store_event::erase::make(content))
+        events.emplace_back("erase " + to_string(del.key()));
+    },
+    [=](atom::store, atom::master, atom::snapshot, const std::string&,
+        caf::actor& clone, uint64_t seq) {
+      self->state.snapshot_requests.emplace_back(seq);
+      if (self->state.connected)
+        self->send(self->state.master, atom::local_v,
+                   make_internal_command<snapshot_command>(
+                     caf::actor_cast<caf::actor>(self), std::move(clone),
+                     seq));
+    },
+  };
+}
+
+struct config : caf::actor_system_config {
+public:
+  config() {
+    configuration::add_message_types(*this);
+  }
+};
+
+struct fixture : test_coordinator_fixture<config> {
+  endpoint::clock clock{&sys, false};
+
+  caf::actor core;
+
+  caf::actor master;
+
+  caf::actor clone;
+
+  caf::actor updates;
+
+  topic clone_topic = "foo" / topics::clone_suffix;
+
+  fixture() {
+    core = sys.spawn(fake_core);
+    master = sys.spawn(fake_master);
+    clone = sys.spawn(clone_actor, core, std::string{"foo"}, 1.0, -1.0, -1.0,
+                      &clock);
+    run();
+    anon_send(clone, atom::master_v, master);
+    run();
+    // Stream of regular store traffic, as the core would send it.
+    updates = sys.spawn(source<command_message>, clone);
+    run();
+  }
+
+  ~fixture() {
+    for (auto& hdl : {updates, clone, master, core})
+      anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+    run();
+  }
+
+  clone_state& state() {
+    return deref<caf::stateful_actor<clone_state>>(clone).state;
+  }
+
+  const std::vector<uint64_t>& snapshot_requests() {
+    return deref<caf::stateful_actor<fake_core_state>>(core)
+      .state.snapshot_requests;
+  }
+
+  data content() {
+    table result;
+    for (auto& kvp : state().store)
+      result.emplace(kvp.first, kvp.second);
+    return data{std::move(result)};
+  }
+
+  void push_update(internal_command cmd, uint64_t seq) {
+    cmd.seq = seq;
+    anon_send(updates, make_command_message(clone_topic, std::move(cmd)));
+    run();
+  }
+
+  void push_sync(uint64_t seq) {
+    push_update(make_internal_command<snapshot_sync_command>(clone), seq);
+  }
+
+  void push_put(data key, data value, uint64_t seq) {
+    push_update(make_internal_command<put_command>(std::move(key),
+                                                   std::move(value)),
+                seq);
+  }
+
+  // Opens a snapshot stream to the clone and sends `entries` over it.
+  caf::actor start_snapshot(std::vector<snapshot_entry> entries) {
+    auto hdl = sys.spawn(source<snapshot_entry>, clone);
+    for (auto& entry : entries)
+      anon_send(hdl, std::move(entry));
+    run();
+    return hdl;
+  }
+
+  void finish_snapshot(const caf::actor& hdl) {
+    anon_send(hdl, atom::ok_v);
+    run();
+  }
+};
+
+// Runs a real master and a real clone that talk through a router.
+struct resync_fixture : test_coordinator_fixture<config> {
+  endpoint::clock clock{&sys, false};
+
+  caf::actor core;
+
+  caf::actor master;
+
+  caf::actor clone;
+
+  caf::actor updates;
+
+  resync_fixture() {
+    core = sys.spawn(router);
+    master = sys.spawn(master_actor, core, std::string{"foo"},
+                       make_backend(backend::memory, backend_options{}),
+                       &clock, size_t{3});
+    clone = sys.spawn(clone_actor, core, std::string{"foo"}, 1.0, -1.0, -1.0,
+                      &clock);
+    updates = sys.spawn(source<command_message>, clone);
+    auto& st = routing();
+    st.master = master;
+    st.clone = clone;
+    st.updates = updates;
+    run();
+    anon_send(clone, atom::master_v, master);
+    run();
+  }
+
+  ~resync_fixture() {
+    for (auto& hdl : {updates, clone, master, core})
+      anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+    run();
+  }
+
+  router_state& routing() {
+    return deref<caf::stateful_actor<router_state>>(core).state;
+  }
+
+  clone_state& clone_st() {
+    return deref<caf::stateful_actor<clone_state>>(clone).state;
+  }
+
+  master_state& master_st() {
+    return deref<caf::stateful_actor<master_state>>(master).state;
+  }
+
+  data content() {
+    table result;
+    for (auto& kvp : clone_st().store)
+      result.emplace(kvp.first, kvp.second);
+    return data{std::move(result)};
+  }
+
+  void put(data key, data value) {
+    anon_send(master, atom::local_v,
+              make_internal_command<put_command>(std::move(key),
+                                                 std::move(value)));
+    run();
+  }
+
+  void erase(data key) {
+    anon_send(master, atom::local_v,
+              make_internal_command<erase_command>(std::move(key)));
+    run();
+  }
+
+  // Lets the clone lose its master while the master keeps running.
+  void disconnect() {
+    routing().connected = false;
+    anon_send(clone, caf::down_msg{master.address(),
+                                   caf::exit_reason::unreachable});
+    run();
+    REQUIRE(clone_st().master == nullptr);
+    routing().clone_events.clear();
+  }
+
+  void reconnect() {
+    routing().connected = true;
+    anon_send(clone, atom::master_v, master);
+    run();
+  }
+
+  std::vector<std::string> sorted_clone_events() {
+    auto result = routing().clone_events;
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(clone_tests, fixture)
+
+TEST(the clone requests a snapshot after resolving its master) {
+  CHECK_EQUAL(snapshot_requests(), std::vector<uint64_t>({0}));
+  CHECK(state().awaiting_snapshot);
+  CHECK(state().awaiting_snapshot_sync);
+}
+
+TEST(the clone replays pending updates if the sync arrives first) {
+  push_put("a", 0, 1);
+  CHECK(state().pending_remote_updates.empty());
+  push_sync(5);
+  push_put("c", 3, 6);
+  CHECK_EQUAL(state().pending_remote_updates.size(), 1u);
+  auto snapshot = start_snapshot({{"a", 1}, {"b", 2}});
+  CHECK(state().awaiting_snapshot);
+  finish_snapshot(snapshot);
+  CHECK(!state().awaiting_snapshot);
+  CHECK(!state().awaiting_snapshot_sync);
+  CHECK(state().pending_remote_updates.empty());
+  CHECK_EQUAL(content(), data(table{{"a", 1}, {"b", 2}, {"c", 3}}));
+  CHECK_EQUAL(state().seq, 6u);
+}
+
+TEST(the clone adopts the sync point if the snapshot arrives first) {
+  finish_snapshot(start_snapshot({{"a", 1}, {"b", 2}}));
+  CHECK(!state().awaiting_snapshot);
+  CHECK(state().awaiting_snapshot_sync);
+  CHECK_EQUAL(state().seq, 0u);
+  // The clone drops updates until it knows where the snapshot ends.
+  push_put("b", 0, 4);
+  CHECK_EQUAL(content(), data(table{{"a", 1}, {"b", 2}}));
+  push_sync(5);
+  CHECK(!state().awaiting_snapshot_sync);
+  CHECK_EQUAL(state().seq, 5u);
+  push_put("c", 3, 6);
+  CHECK_EQUAL(content(), data(table{{"a", 1}, {"b", 2}, {"c", 3}}));
+  CHECK_EQUAL(state().seq, 6u);
+}
+
+TEST(the clone erases keys that a snapshot no longer contains) {
+  push_sync(1);
+  finish_snapshot(start_snapshot({{"a", 1}, {"b", 2}}));
+  CHECK_EQUAL(content(), data(table{{"a", 1}, {"b", 2}}));
+  state().awaiting_snapshot = true;
+  state().awaiting_snapshot_sync = true;
+  push_sync(2);
+  finish_snapshot(start_snapshot({{"b", 3}}));
+  CHECK_EQUAL(content(), data(table{{"b", 3}}));
+  CHECK_EQUAL(state().seq, 2u);
+}
+
+TEST(the clone starts over if the snapshot stream aborts) {
+  push_sync(5);
+  push_put("c", 3, 6);
+  auto snapshot = start_snapshot({{"a", 1}});
+  CHECK_EQUAL(content(), data(table{{"a", 1}}));
+  anon_send_exit(snapshot, caf::exit_reason::kill);
+  run();
+  MESSAGE("the clone keeps partial state but drops the pending updates");
+  CHECK_EQUAL(content(), data(table{{"a", 1}}));
+  CHECK(state().awaiting_snapshot);
+  CHECK(state().awaiting_snapshot_sync);
+  CHECK(state().pending_remote_updates.empty());
+  CHECK(state().snapshot_stale_keys.empty());
+  CHECK_EQUAL(state().seq, 0u);
+  MESSAGE("the clone asks for a new snapshot");
+  CHECK_EQUAL(snapshot_requests(), std::vector<uint64_t>({0, 0}));
+  MESSAGE("the clone recovers with the next snapshot");
+  push_sync(7);
+  push_put("d", 4, 8);
+  finish_snapshot(start_snapshot({{"a", 1}, {"b", 2}, {"c", 3}}));
+  CHECK_EQUAL(content(), data(table{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}}));
+  CHECK_EQUAL(state().seq, 8u);
+}
+
+FIXTURE_SCOPE_END()
+
+FIXTURE_SCOPE(clone_resync_tests, resync_fixture)
+
+TEST(reconnecting clones receive the changes they missed) {
+  put("a", 1);
+  CHECK_EQUAL(content(), data(table{{"a", 1}}));
+  CHECK_EQUAL(clone_st().seq, 1u);
+  disconnect();
+  put("b", 2);
+  put("a", 3);
+  MESSAGE("the master keeps updating the store while the clone reconnects");
+  routing().connected = true;
+  anon_send(clone, atom::master_v, master);
+  anon_send(master, atom::local_v, make_internal_command<put_command>("c", 4));
+  run();
+  CHECK_EQUAL(routing().snapshot_requests, std::vector<uint64_t>({0, 1}));
+  CHECK(!clone_st().awaiting_snapshot);
+  CHECK(!clone_st().awaiting_snapshot_sync);
+  CHECK(clone_st().pending_remote_updates.empty());
+  CHECK_EQUAL(content(), data(table{{"a", 3}, {"b", 2}, {"c", 4}}));
+  CHECK_EQUAL(master_st().seq, 4u);
+  CHECK_EQUAL(clone_st().seq, 4u);
+  CHECK_EQUAL(sorted_clone_events(),
+              std::vector<std::string>({"insert b", "insert c", "update a"}));
+  MESSAGE("the clone applies regular updates again");
+  put("d", 5);
+  CHECK_EQUAL(clone_st().seq, 5u);
+  CHECK_EQUAL(routing().clone_events.back(), "insert d");
+}
+
+TEST(reconnecting clones fall back to a snapshot if the log is too short) {
+  put("a", 1);
+  put("b", 2);
+  CHECK_EQUAL(clone_st().seq, 2u);
+  disconnect();
+  put("c", 3);
+  put("d", 4);
+  erase("a");
+  put("b", 5);
+  MESSAGE("the log only keeps the commands 4 to 6");
+  CHECK_EQUAL(master_st().change_log.front().seq, 4u);
+  reconnect();
+  CHECK_EQUAL(routing().snapshot_requests, std::vector<uint64_t>({0, 2}));
+  CHECK(!clone_st().awaiting_snapshot);
+  CHECK(!clone_st().awaiting_snapshot_sync);
+  CHECK(clone_st().snapshot_stale_keys.empty());
+  CHECK_EQUAL(content(), data(table{{"b", 5}, {"c", 3}, {"d", 4}}));
+  CHECK_EQUAL(clone_st().seq, 6u);
+  CHECK_EQUAL(sorted_clone_events(),
+              std::vector<std::string>(
+                {"erase a", "insert c", "insert d", "update b"}));
+}
+
+FIXTURE_SCOPE_END()
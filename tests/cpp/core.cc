@@ -672,6 +672,7 @@ CAF_TEST(remote_peers_setup1) {
       CAF_REQUIRE_EQUAL(xs, expected);
     }
   );
+  CAF_CHECK_EQUAL(mars.ep.peering_metrics().duplicates, 0u);
   anon_send_exit(core1, caf::exit_reason::user_shutdown);
   anon_send_exit(core2, caf::exit_reason::user_shutdown);
   anon_send_exit(leaf, caf::exit_reason::user_shutdown);
@@ -741,3 +742,133 @@ CAF_TEST(remote_peers_setup2) {
 }
 
 CAF_TEST_FIXTURE_SCOPE_END()
+
+namespace {
+
+// Peers three nodes in a triangle: earth -> mars, earth -> jupiter and
+// mars -> jupiter. Each node runs a core with a consumer for topic "b".
+struct triangle_fixture : belt_fixture_t<base_fixture> {
+  using buf = std::vector<element_type>;
+
+  template <class Planet>
+  caf::actor spawn_core(Planet& planet, const broker_options& options) {
+    auto core = planet.sys.spawn(core_actor, filter_type{"a", "b", "c"},
+                                 options, nullptr);
+    anon_send(core, atom::no_events_v);
+    stats.emplace_back(detail::make_core_stats());
+    anon_send(core, atom::metrics_v, stats.back());
+    cores.emplace_back(core);
+    leaves.emplace_back(planet.sys.spawn(consumer, filter_type{"b"}, core));
+    return core;
+  }
+
+  void connect(broker_options options) {
+    options.disable_ssl = true;
+    auto core1 = spawn_core(earth, options);
+    auto core2 = spawn_core(mars, options);
+    auto core3 = spawn_core(jupiter, options);
+    exec_all();
+    CAF_MESSAGE("connect the nodes at CAF level");
+    prepare_connection(mars, earth, "mars", 8080u);
+    prepare_connection(jupiter, earth, "jupiter", 8080u);
+    prepare_connection(jupiter, mars, "jupiter", 8081u);
+    exec_all();
+    mars.publish(core2, 8080u);
+    jupiter.publish(core3, 8080u);
+    jupiter.publish(core3, 8081u);
+    exec_all();
+    auto core2_on_earth = earth.remote_actor("mars", 8080u);
+    auto core3_on_earth = earth.remote_actor("jupiter", 8080u);
+    auto core3_on_mars = mars.remote_actor("jupiter", 8081u);
+    exec_all();
+    CAF_MESSAGE("peer the cores");
+    earth.self->send(core1, atom::peer_v, core2_on_earth);
+    exec_all();
+    earth.self->send(core1, atom::peer_v, core3_on_earth);
+    exec_all();
+    mars.self->send(core2, atom::peer_v, core3_on_mars);
+    exec_all();
+  }
+
+  buf log(size_t index) {
+    buf result;
+    earth.self->send(leaves[index], atom::get_v);
+    exec_all();
+    earth.self->receive([&](buf& xs) { result = std::move(xs); });
+    return result;
+  }
+
+  uint64_t duplicates() {
+    uint64_t result = 0;
+    for (auto& ptr : stats)
+      result += ptr->duplicates.load();
+    return result;
+  }
+
+  ~triangle_fixture() {
+    for (auto& hdl : leaves)
+      anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+    for (auto& hdl : cores)
+      anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+    exec_all();
+  }
+
+  std::vector<caf::actor> cores;
+
+  std::vector<caf::actor> leaves;
+
+  std::vector<detail::core_stats_ptr> stats;
+};
+
+} // namespace <anonymous>
+
+CAF_TEST_FIXTURE_SCOPE(peer_topologies, triangle_fixture)
+
+// Data flows from earth to mars and jupiter directly as well as through
+// the loop. Each node must deliver each message exactly once.
+CAF_TEST(flooding_in_a_triangle) {
+  connect(broker_options{});
+  auto d1 = earth.sys.spawn(driver, cores[0], false);
+  CAF_MESSAGE("d1: " << to_string(d1));
+  exec_all();
+  auto expected = data_msgs({{"b", true}, {"b", false},
+                             {"b", true}, {"b", false}});
+  CAF_CHECK_EQUAL(log(0), buf{});
+  CAF_CHECK_EQUAL(log(1), expected);
+  CAF_CHECK_EQUAL(log(2), expected);
+  CAF_CHECK_GREATER(duplicates(), 0u);
+}
+
+CAF_TEST(source_routing_in_a_triangle) {
+  broker_options options;
+  options.source_routing = true;
+  connect(options);
+  auto d1 = earth.sys.spawn(driver, cores[0], false);
+  CAF_MESSAGE("d1: " << to_string(d1));
+  exec_all();
+  auto expected = data_msgs({{"b", true}, {"b", false},
+                             {"b", true}, {"b", false}});
+  CAF_CHECK_EQUAL(log(0), buf{});
+  CAF_CHECK_EQUAL(log(1), expected);
+  CAF_CHECK_EQUAL(log(2), expected);
+  CAF_CHECK_EQUAL(duplicates(), 0u);
+}
+
+// Data flows from mars to both of its peers. Jupiter receives a copy from
+// mars and must not deliver the copy that earth forwards.
+CAF_TEST(source_routing_from_a_middle_node) {
+  broker_options options;
+  options.source_routing = true;
+  connect(options);
+  auto d1 = mars.sys.spawn(driver, cores[1], false);
+  CAF_MESSAGE("d1: " << to_string(d1));
+  exec_all();
+  auto expected = data_msgs({{"b", true}, {"b", false},
+                             {"b", true}, {"b", false}});
+  CAF_CHECK_EQUAL(log(0), expected);
+  CAF_CHECK_EQUAL(log(1), buf{});
+  CAF_CHECK_EQUAL(log(2), expected);
+  CAF_CHECK_EQUAL(duplicates(), 0u);
+}
+
+CAF_TEST_FIXTURE_SCOPE_END()
@@ -0,0 +1,138 @@
+#define SUITE blocked_peer_buffer
+
+#include "broker/detail/blocked_peer_buffer.hh"
+
+#include "test.hh"
+
+#include <string>
+
+#include <caf/detail/serialized_size.hpp>
+#include <caf/error.hpp>
+
+#include "broker/detail/filesystem.hh"
+#include "broker/internal_command.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+caf::message make_batch(size_t size, char value) {
+  return caf::make_message(std::string(size, value));
+}
+
+struct fixture : base_fixture {
+  std::vector<std::string> drained;
+
+  std::string spill_file = detail::make_temp_file_name();
+
+  ~fixture() {
+    detail::remove(spill_file);
+  }
+
+  size_t size_of(const caf::message& x) {
+    return caf::detail::serialized_size(sys, x);
+  }
+
+  auto consumer() {
+    return [this](caf::message& x) {
+      drained.emplace_back(x.get_as<std::string>(0));
+    };
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(blocked_peer_buffer_tests, fixture)
+
+TEST(the buffer reports full after reaching its byte limit) {
+  auto n = size_of(make_batch(6, 'a'));
+  detail::blocked_peer_buffer uut{sys, 2 * n - 1, 100};
+  CHECK_EQUAL(uut.push(make_batch(6, 'a'), 1), caf::none);
+  CHECK(!uut.full());
+  CHECK_EQUAL(uut.push(make_batch(6, 'b'), 1), caf::none);
+  CHECK(uut.full());
+  CHECK_EQUAL(uut.buffered_bytes(), 2 * n);
+  CHECK_EQUAL(uut.buffered_messages(), 2u);
+}
+
+TEST(the buffer reports full after reaching its message limit) {
+  detail::blocked_peer_buffer uut{sys, 1024, 3};
+  CHECK_EQUAL(uut.push(make_batch(1, 'a'), 2), caf::none);
+  CHECK(!uut.full());
+  CHECK_EQUAL(uut.push(make_batch(1, 'b'), 1), caf::none);
+  CHECK(uut.full());
+}
+
+TEST(draining the buffer returns all batches in order) {
+  detail::blocked_peer_buffer uut{sys, 1024, 100};
+  for (size_t i = 1; i <= 3; ++i)
+    CHECK_EQUAL(uut.push(make_batch(i, 'a'), 1), caf::none);
+  CHECK_EQUAL(uut.drain(consumer()), caf::none);
+  REQUIRE_EQUAL(drained.size(), 3u);
+  CHECK_EQUAL(drained[0], "a");
+  CHECK_EQUAL(drained[1], "aa");
+  CHECK_EQUAL(drained[2], "aaa");
+  CHECK_EQUAL(uut.buffered_bytes(), 0u);
+}
+
+TEST(full buffers spill additional batches to disk) {
+  detail::blocked_peer_buffer uut{sys, size_of(make_batch(10, 'a')), 100,
+                                  spill_file};
+  CHECK_EQUAL(uut.push(make_batch(10, 'a'), 1), caf::none);
+  CHECK_EQUAL(uut.push(make_batch(3, 'b'), 1), caf::none);
+  CHECK_EQUAL(uut.push(make_batch(4, 'c'), 2), caf::none);
+  CHECK_EQUAL(uut.buffered_bytes(), size_of(make_batch(10, 'a')));
+  CHECK_EQUAL(uut.spilled_bytes(),
+              size_of(make_batch(3, 'b')) + size_of(make_batch(4, 'c')));
+  CHECK_EQUAL(uut.spilled_messages(), 3u);
+  CHECK(detail::exists(spill_file));
+  CHECK_EQUAL(uut.drain(consumer()), caf::none);
+  REQUIRE_EQUAL(drained.size(), 3u);
+  CHECK_EQUAL(drained[0], std::string(10, 'a'));
+  CHECK_EQUAL(drained[1], "bbb");
+  CHECK_EQUAL(drained[2], "cccc");
+  CHECK_EQUAL(uut.spilled_bytes(), 0u);
+  CHECK(!detail::exists(spill_file));
+}
+
+TEST(the buffer reports errors while spilling to its caller) {
+  detail::blocked_peer_buffer uut{sys, 1, 100,
+                                  spill_file + "/no/such/dir/file"};
+  CHECK_EQUAL(uut.push(make_batch(1, 'a'), 1), caf::none);
+  CHECK_NOT_EQUAL(uut.push(make_batch(1, 'b'), 1), caf::none);
+  CHECK_EQUAL(uut.spilled_messages(), 0u);
+}
+
+TEST(spilled batches keep the actor handles of store commands) {
+  using batch_type = std::vector<node_message>;
+  auto cmd = make_internal_command<put_unique_command>(
+    "key", "value", nil, caf::actor_cast<caf::actor>(self), request_id{42},
+    publisher_id{});
+  auto msg = make_node_message(
+    node_message_content{make_command_message("foo" / topics::master_suffix,
+                                              std::move(cmd))},
+    20);
+  detail::blocked_peer_buffer uut{sys, 1, 100, spill_file};
+  CHECK_EQUAL(uut.push(make_batch(1, 'a'), 1), caf::none);
+  CHECK_EQUAL(uut.push(caf::make_message(batch_type{msg}), 1), caf::none);
+  CHECK_EQUAL(uut.spilled_messages(), 1u);
+  std::vector<caf::message> replayed;
+  CHECK_EQUAL(uut.drain([&](caf::message& x) { replayed.emplace_back(x); }),
+              caf::none);
+  REQUIRE_EQUAL(replayed.size(), 2u);
+  REQUIRE(replayed[1].match_elements<batch_type>());
+  auto& xs = replayed[1].get_as<batch_type>(0);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  auto& content = get_content(xs[0]);
+  REQUIRE(caf::holds_alternative<command_message>(content));
+  auto& ys = get_command(caf::get<command_message>(content));
+  REQUIRE(caf::holds_alternative<put_unique_command>(ys));
+  auto& y = caf::get<put_unique_command>(ys);
+  CHECK_EQUAL(y.key, data{"key"});
+  CHECK_EQUAL(y.who, caf::actor_cast<caf::actor>(self));
+  CHECK_EQUAL(y.req_id, 42u);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,82 @@
+#define SUITE dedup_window
+
+#include "broker/detail/dedup_window.hh"
+
+#include "test.hh"
+
+#include <string>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  detail::dedup_window<std::string> uut{3};
+};
+
+} // namespace
+
+FIXTURE_SCOPE(dedup_window_tests, fixture)
+
+TEST(the window detects repeated messages) {
+  CHECK(uut.insert("a", 1));
+  CHECK(uut.insert("a", 2));
+  CHECK(uut.insert("b", 1));
+  CHECK(!uut.insert("a", 1));
+  CHECK(!uut.insert("b", 1));
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK_EQUAL(uut.duplicates(), 2u);
+}
+
+TEST(the window evicts the oldest entries) {
+  CHECK(uut.insert("a", 1));
+  CHECK(uut.insert("a", 2));
+  CHECK(uut.insert("a", 3));
+  CHECK(uut.insert("a", 4));
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK(uut.insert("a", 1));
+  CHECK(!uut.insert("a", 4));
+}
+
+TEST(each origin has its own window) {
+  CHECK(uut.insert("a", 1));
+  for (uint64_t seq = 1; seq <= 5; ++seq)
+    CHECK(uut.insert("b", seq));
+  CHECK_EQUAL(uut.origins(), 2u);
+  CHECK_EQUAL(uut.size(), 4u);
+  CHECK(!uut.insert("a", 1));
+  CHECK(uut.insert("b", 1));
+}
+
+TEST(shrinking the window drops the oldest entries) {
+  CHECK(uut.insert("a", 1));
+  CHECK(uut.insert("a", 2));
+  uut.capacity(1);
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK(!uut.insert("a", 2));
+  CHECK(uut.insert("a", 1));
+}
+
+TEST(the window drops the least recently active origin) {
+  uut.max_origins(2);
+  CHECK(uut.insert("a", 1));
+  CHECK(uut.insert("b", 1));
+  CHECK(!uut.insert("a", 1));
+  MESSAGE("adding c evicts b, since a was active more recently");
+  CHECK(uut.insert("c", 1));
+  CHECK_EQUAL(uut.origins(), 2u);
+  CHECK_EQUAL(uut.size(), 2u);
+  CHECK(!uut.insert("a", 1));
+  CHECK(uut.insert("b", 1));
+  CHECK_EQUAL(uut.origins(), 2u);
+}
+
+TEST(a window with capacity 0 accepts everything) {
+  uut.capacity(0);
+  CHECK(uut.insert("a", 1));
+  CHECK(uut.insert("a", 1));
+  CHECK_EQUAL(uut.size(), 0u);
+  CHECK_EQUAL(uut.duplicates(), 0u);
+}
+
+FIXTURE_SCOPE_END()
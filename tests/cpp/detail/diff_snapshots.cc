@@ -0,0 +1,153 @@
+#define SUITE diff_snapshots
+
+#include "broker/detail/diff_snapshots.hh"
+
+#include "test.hh"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/snapshot.hh"
+
+using namespace broker;
+
+namespace {
+
+using event_list = std::vector<std::string>;
+
+std::string erase_event(const data& key) {
+  return "erase " + to_string(key);
+}
+
+std::string update_event(const data& key, const data& old_value,
+                         const data& new_value) {
+  return "update " + to_string(key) + " " + to_string(old_value) + " "
+         + to_string(new_value);
+}
+
+std::string insert_event(const data& key, const data& value) {
+  return "insert " + to_string(key) + " " + to_string(value);
+}
+
+event_list hashed_merge(const snapshot& store, const snapshot& state) {
+  event_list result;
+  detail::diff_snapshots(
+    store, state,
+    [&](const data& key) { result.emplace_back(erase_event(key)); },
+    [&](const data& key, const data& old_value, const data& new_value) {
+      result.emplace_back(update_event(key, old_value, new_value));
+    },
+    [&](const data& key, const data& value) {
+      result.emplace_back(insert_event(key, value));
+    });
+  return result;
+}
+
+// The algorithm of clone_state::operator()(set_command&) before switching to
+// `detail::diff_snapshots`.
+event_list linear_scan(snapshot store, snapshot state) {
+  event_list result;
+  if (store.empty()) {
+    for (auto& [key, value] : state)
+      result.emplace_back(insert_event(key, value));
+    return result;
+  }
+  std::vector<const data*> keys;
+  keys.reserve(store.size());
+  for (auto& kvp : store)
+    keys.emplace_back(&kvp.first);
+  auto is_erased = [&state](const data* key) { return state.count(*key) == 0; };
+  auto p = std::partition(keys.begin(), keys.end(), is_erased);
+  for (auto i = keys.begin(); i != p; ++i)
+    result.emplace_back(erase_event(**i));
+  for (auto i = p; i != keys.end(); ++i) {
+    const auto& value = state[**i];
+    result.emplace_back(update_event(**i, store[**i], value));
+  }
+  auto is_new = [&keys](const data& key) {
+    for (const auto key_ptr : keys)
+      if (*key_ptr == key)
+        return false;
+    return true;
+  };
+  for (const auto& [key, value] : state)
+    if (is_new(key))
+      result.emplace_back(insert_event(key, value));
+  return result;
+}
+
+// Both algorithms emit all erase events first, then all update events and
+// finally all insert events. Within each group, the order depends on the
+// iteration order of the hash maps.
+event_list normalize(event_list xs) {
+  auto rank = [](const std::string& x) {
+    switch (x.front()) {
+      case 'e':
+        return 0;
+      case 'u':
+        return 1;
+      default:
+        return 2;
+    }
+  };
+  CHECK(std::is_sorted(xs.begin(), xs.end(),
+                       [&](const std::string& x, const std::string& y) {
+                         return rank(x) < rank(y);
+                       }));
+  std::sort(xs.begin(), xs.end());
+  return xs;
+}
+
+struct fixture {
+  void check_equivalence(const snapshot& store, const snapshot& state) {
+    auto expected = normalize(linear_scan(store, state));
+    auto events = normalize(hashed_merge(store, state));
+    CHECK_EQUAL(events, expected);
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(diff_snapshots_tests, fixture)
+
+TEST(empty stores receive insert events only) {
+  check_equivalence({}, {});
+  check_equivalence({}, {{"a", 1}, {"b", 2}});
+  CHECK_EQUAL(normalize(hashed_merge({}, {{"a", 1}, {"b", 2}})),
+              event_list({"insert a 1", "insert b 2"}));
+}
+
+TEST(empty snapshots erase all keys) {
+  check_equivalence({{"a", 1}, {"b", 2}}, {});
+  CHECK_EQUAL(normalize(hashed_merge({{"a", 1}, {"b", 2}}, {})),
+              event_list({"erase a", "erase b"}));
+}
+
+TEST(identical states only emit update events) {
+  snapshot xs{{"a", 1}, {"b", 2}, {"c", 3}};
+  check_equivalence(xs, xs);
+  CHECK_EQUAL(normalize(hashed_merge(xs, xs)),
+              event_list({"update a 1 1", "update b 2 2", "update c 3 3"}));
+}
+
+TEST(mixed changes emit the same events as the linear scan) {
+  check_equivalence({{"a", 1}, {"b", 2}, {"c", 3}},
+                    {{"b", 20}, {"c", 3}, {"d", 4}});
+  CHECK_EQUAL(normalize(hashed_merge({{"a", 1}, {"b", 2}, {"c", 3}},
+                                     {{"b", 20}, {"c", 3}, {"d", 4}})),
+              event_list({"erase a", "insert d 4", "update b 2 20",
+                          "update c 3 3"}));
+  snapshot store;
+  snapshot state;
+  for (integer i = 0; i < 1000; ++i) {
+    if (i % 3 != 0)
+      store.emplace(i, i);
+    if (i % 5 != 0)
+      state.emplace(i, i * 2);
+  }
+  check_equivalence(store, state);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,66 @@
+#define SUITE flare
+
+#include "broker/detail/flare.hh"
+
+#include "test.hh"
+
+#include <thread>
+
+#include <poll.h>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  detail::flare uut;
+
+  bool ready() {
+    pollfd p = {uut.fd(), POLLIN, 0};
+    return ::poll(&p, 1, 0) == 1;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(flare_tests, fixture)
+
+TEST(the flare is ready as long as it has pending signals) {
+  CHECK(!ready());
+  uut.fire();
+  CHECK(ready());
+  uut.fire(2);
+  CHECK(ready());
+  CHECK(uut.extinguish_one());
+  CHECK(ready());
+  CHECK(uut.extinguish_one());
+  CHECK(uut.extinguish_one());
+  CHECK(!ready());
+  CHECK(!uut.extinguish_one());
+}
+
+TEST(extinguish consumes all pending signals) {
+  uut.fire(3);
+  CHECK_EQUAL(uut.extinguish(), 3u);
+  CHECK(!ready());
+  CHECK_EQUAL(uut.extinguish(), 0u);
+}
+
+TEST(the consumer receives each signal from a concurrent producer) {
+  constexpr size_t n = 100000;
+  std::thread producer{[this] {
+    for (size_t i = 0; i < n; ++i)
+      uut.fire();
+  }};
+  size_t received = 0;
+  while (received < n) {
+    uut.await_one();
+    while (uut.extinguish_one())
+      ++received;
+  }
+  producer.join();
+  CHECK_EQUAL(received, n);
+  CHECK(!ready());
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,100 @@
+#define SUITE indexed_downstream_manager
+
+#include "broker/detail/indexed_downstream_manager.hh"
+
+#include "test.hh"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <caf/outbound_path.hpp>
+
+#include "broker/detail/prefix_matcher.hh"
+
+using namespace broker;
+
+namespace {
+
+using manager_base
+  = detail::indexed_downstream_manager<data_message, filter_type,
+                                       detail::prefix_matcher>;
+
+// Counts the elements that the manager moved out of its central buffer.
+class manager : public manager_base {
+public:
+  using manager_base::manager_base;
+
+  size_t moved = 0;
+
+protected:
+  void fan_out(iterator first, iterator last,
+               const detail::topic_index::id_list& positions) override {
+    manager_base::fan_out(first, last, positions);
+    auto moved_from = [](const data_message& x) { return x.ptr() == nullptr; };
+    moved += static_cast<size_t>(std::count_if(first, last, moved_from));
+  }
+};
+
+struct fixture {
+  manager uut{nullptr};
+
+  fixture() {
+    add_path(1, {"a"});
+    add_path(2, {"a", "b"});
+    add_path(3, {"a"});
+  }
+
+  void add_path(caf::stream_slot slot, filter_type filter) {
+    uut.insert_path(std::make_unique<caf::outbound_path>(slot, nullptr));
+    uut.set_filter(slot, std::move(filter));
+  }
+
+  // Returns the buffer of the path at `slot`.
+  const std::vector<data_message>& buf(caf::stream_slot slot) {
+    return uut.states().container()[slot - 1].second.buf;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(indexed_downstream_manager_tests, fixture)
+
+TEST(the last receiver gets the moved elements) {
+  uut.push(make_data_message("a", 1));
+  uut.push(make_data_message("a", 2));
+  uut.push(make_data_message("b", 3));
+  uut.fan_out_flush();
+  CHECK_EQUAL(uut.moved, 3u);
+  CHECK(uut.buf().empty());
+  auto as = data_msgs({{"a", 1}, {"a", 2}});
+  CHECK_EQUAL(buf(1), as);
+  CHECK_EQUAL(buf(2), data_msgs({{"a", 1}, {"a", 2}, {"b", 3}}));
+  CHECK_EQUAL(buf(3), as);
+  // Copies share their content with the moved element.
+  CHECK(buf(1)[0].ptr() == buf(3)[0].ptr());
+  CHECK(buf(2)[1].ptr() == buf(3)[1].ptr());
+}
+
+TEST(the manager skips closing paths when picking the last receiver) {
+  uut.path(3)->closing = true;
+  uut.push(make_data_message("a", 1));
+  uut.push(make_data_message("a", 2));
+  uut.fan_out_flush();
+  CHECK_EQUAL(uut.moved, 2u);
+  auto as = data_msgs({{"a", 1}, {"a", 2}});
+  CHECK_EQUAL(buf(1), as);
+  CHECK_EQUAL(buf(2), as);
+  CHECK(buf(3).empty());
+}
+
+TEST(the manager keeps elements without receivers in place) {
+  uut.push(make_data_message("c", 1));
+  uut.fan_out_flush();
+  CHECK_EQUAL(uut.moved, 0u);
+  CHECK(buf(1).empty());
+  CHECK(buf(2).empty());
+  CHECK(buf(3).empty());
+}
+
+FIXTURE_SCOPE_END()
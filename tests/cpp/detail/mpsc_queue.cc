@@ -0,0 +1,91 @@
+#define SUITE mpsc_queue
+
+#include "broker/detail/mpsc_queue.hh"
+
+#include "test.hh"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  detail::mpsc_queue<int> uut;
+
+  std::vector<int> drain() {
+    std::vector<int> result;
+    uut.drain([&result](int x) { result.emplace_back(x); });
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(mpsc_queue_tests, fixture)
+
+TEST(push reports whether the queue was empty) {
+  CHECK(uut.empty());
+  CHECK(uut.push(1));
+  CHECK(!uut.push(2));
+  CHECK(!uut.empty());
+  drain();
+  CHECK(uut.empty());
+  CHECK(uut.push(3));
+}
+
+TEST(drain returns elements in the order of insertion) {
+  uut.push(1);
+  std::vector<int> xs{2, 3, 4};
+  uut.push(xs.begin(), xs.end());
+  uut.push(5);
+  CHECK_EQUAL(drain(), std::vector<int>({1, 2, 3, 4, 5}));
+  CHECK(drain().empty());
+}
+
+TEST(pushing an empty range leaves the queue unchanged) {
+  std::vector<int> xs;
+  CHECK(!uut.push(xs.begin(), xs.end()));
+  CHECK(uut.empty());
+}
+
+TEST(the destructor releases remaining elements) {
+  auto x = std::make_shared<int>(42);
+  {
+    detail::mpsc_queue<std::shared_ptr<int>> q;
+    q.push(x);
+    q.push(x);
+    CHECK_EQUAL(x.use_count(), 3);
+  }
+  CHECK_EQUAL(x.use_count(), 1);
+}
+
+TEST(multiple producers can push concurrently) {
+  constexpr int num_producers = 4;
+  constexpr int n = 25000;
+  std::vector<std::thread> producers;
+  for (int id = 0; id < num_producers; ++id)
+    producers.emplace_back([this, id] {
+      for (int i = 0; i < n; ++i)
+        uut.push(id * n + i);
+    });
+  // Elements of each producer must arrive in order.
+  std::vector<int> next(num_producers);
+  size_t received = 0;
+  bool in_order = true;
+  while (received < num_producers * n)
+    received += uut.drain([&](int x) {
+      auto& expected = next[x / n];
+      if (x % n != expected)
+        in_order = false;
+      ++expected;
+    });
+  for (auto& t : producers)
+    t.join();
+  CHECK(in_order);
+  CHECK(uut.empty());
+}
+
+FIXTURE_SCOPE_END()
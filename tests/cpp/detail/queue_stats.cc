@@ -0,0 +1,90 @@
+#define SUITE queue_stats
+
+#include "broker/detail/queue_stats.hh"
+
+#include "test.hh"
+
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+using histogram = detail::latency_histogram;
+
+struct fixture {
+  histogram uut;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(queue_stats_tests, fixture)
+
+TEST(small values map to exact buckets) {
+  for (uint64_t x = 0; x < histogram::sub_buckets * 2; ++x)
+    CHECK_EQUAL(histogram::upper_bound_of(histogram::bucket_of(x)), x);
+}
+
+TEST(buckets overestimate values by at most one eighth) {
+  std::vector<uint64_t> xs{17, 100, 1000, 123456, 987654321,
+                           uint64_t{1} << 40, ~uint64_t{0}};
+  for (auto x : xs) {
+    auto idx = histogram::bucket_of(x);
+    CHECK(idx < histogram::num_buckets);
+    auto ub = histogram::upper_bound_of(idx);
+    CHECK(ub >= x);
+    CHECK(ub - x <= x / 8);
+  }
+}
+
+TEST(percentiles approximate the recorded distribution) {
+  CHECK_EQUAL(uut.percentile(0.5), 0u);
+  for (uint64_t x = 1; x <= 1000; ++x)
+    uut.record(x * 1000);
+  CHECK_EQUAL(uut.count(), 1000u);
+  CHECK_EQUAL(uut.max(), 1000000u);
+  auto p50 = uut.percentile(0.5);
+  CHECK(p50 >= 500000u && p50 <= 500000u + 500000u / 8);
+  auto p99 = uut.percentile(0.99);
+  CHECK(p99 >= 990000u && p99 <= 1000000u);
+  CHECK_EQUAL(uut.percentile(1.0), 1000000u);
+}
+
+TEST(record accepts weights) {
+  uut.record(10, 99);
+  uut.record(5000, 1);
+  CHECK_EQUAL(uut.count(), 100u);
+  CHECK_EQUAL(uut.percentile(0.5), 10u);
+  CHECK_EQUAL(uut.percentile(0.99), 10u);
+  CHECK_EQUAL(uut.max(), 5000u);
+}
+
+TEST(concurrent writers lose no values) {
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < 4; ++i)
+    threads.emplace_back([this, i] {
+      for (uint64_t x = 0; x < 10000; ++x)
+        uut.record(x * (i + 1));
+    });
+  for (auto& t : threads)
+    t.join();
+  CHECK_EQUAL(uut.count(), 40000u);
+  CHECK_EQUAL(uut.max(), 39996u);
+}
+
+TEST(queue stats count items and latencies) {
+  detail::queue_stats stats;
+  stats.on_enqueue(10);
+  stats.on_dequeue(4, std::chrono::microseconds(3));
+  stats.on_drop(2);
+  auto m = stats.metrics("test");
+  CHECK_EQUAL(m.name, "test");
+  CHECK_EQUAL(m.enqueued, 10u);
+  CHECK_EQUAL(m.dequeued, 4u);
+  CHECK_EQUAL(m.dropped, 2u);
+  CHECK(m.latency_p50 >= std::chrono::microseconds(3));
+  CHECK(m.latency_max == std::chrono::microseconds(3));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,97 @@
+#define SUITE spsc_queue
+
+#include "broker/detail/spsc_queue.hh"
+
+#include "test.hh"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+using queue_type = detail::spsc_queue<int, 4>;
+
+struct fixture {
+  queue_type uut;
+
+  std::vector<int> pop(size_t num) {
+    std::vector<int> result;
+    auto f = [&result](int x) { result.emplace_back(x); };
+    uut.pop(num, f);
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(spsc_queue_tests, fixture)
+
+TEST(a default-constructed queue is empty) {
+  CHECK(uut.empty());
+  CHECK_EQUAL(uut.size(), 0u);
+  CHECK(pop(10).empty());
+}
+
+TEST(push returns the size before adding elements) {
+  CHECK_EQUAL(uut.push(1), 0u);
+  CHECK_EQUAL(uut.push(2), 1u);
+  std::vector<int> xs{3, 4, 5};
+  CHECK_EQUAL(uut.push(xs.begin(), xs.end()), 2u);
+  CHECK_EQUAL(uut.size(), 5u);
+}
+
+TEST(pop removes elements in FIFO order across blocks) {
+  for (int i = 0; i < 10; ++i)
+    uut.push(i);
+  CHECK_EQUAL(pop(3), std::vector<int>({0, 1, 2}));
+  CHECK_EQUAL(pop(5), std::vector<int>({3, 4, 5, 6, 7}));
+  for (int i = 10; i < 13; ++i)
+    uut.push(i);
+  CHECK_EQUAL(pop(10), std::vector<int>({8, 9, 10, 11, 12}));
+  CHECK(uut.empty());
+}
+
+TEST(pop reports the size before removing elements) {
+  uut.push(1);
+  uut.push(2);
+  auto f = [](int) {};
+  auto [n, prev_size] = uut.pop(1, f);
+  CHECK_EQUAL(n, 1u);
+  CHECK_EQUAL(prev_size, 2u);
+}
+
+TEST(the destructor releases remaining elements) {
+  auto x = std::make_shared<int>(42);
+  {
+    detail::spsc_queue<std::shared_ptr<int>, 4> q;
+    for (int i = 0; i < 10; ++i)
+      q.push(x);
+    CHECK_EQUAL(x.use_count(), 11);
+  }
+  CHECK_EQUAL(x.use_count(), 1);
+}
+
+TEST(one producer and one consumer can access the queue concurrently) {
+  constexpr int n = 100000;
+  std::thread producer{[this] {
+    for (int i = 0; i < n; ++i)
+      uut.push(i);
+  }};
+  std::vector<int> received;
+  received.reserve(n);
+  auto f = [&received](int x) { received.emplace_back(x); };
+  while (received.size() < static_cast<size_t>(n))
+    uut.pop(64, f);
+  producer.join();
+  bool in_order = true;
+  for (int i = 0; i < n; ++i)
+    if (received[i] != i)
+      in_order = false;
+  CHECK(in_order);
+  CHECK(uut.empty());
+}
+
+FIXTURE_SCOPE_END()
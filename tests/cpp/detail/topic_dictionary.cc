@@ -0,0 +1,87 @@
+#define SUITE topic_dictionary
+
+#include "broker/detail/topic_dictionary.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  detail::topic_encoder encoder;
+  detail::topic_decoder decoder;
+
+  // Encodes `x`, sends it over a (simulated) wire and decodes it again.
+  std::pair<node_message, size_t> transmit(node_message x) {
+    encoder.encode(x);
+    caf::binary_serializer::container_type buf;
+    caf::binary_serializer sink{nullptr, buf};
+    CHECK_EQUAL(sink(x), caf::none);
+    node_message result;
+    caf::binary_deserializer source{nullptr, buf};
+    CHECK_EQUAL(source(result), caf::none);
+    CHECK(decoder.decode(result));
+    return {std::move(result), buf.size()};
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(topic_dictionary_tests, fixture)
+
+TEST(the first message on a topic carries the topic string) {
+  auto msg = make_node_message(make_data_message("zeek/events/foo", 42), 20);
+  encoder.encode(msg);
+  CHECK_EQUAL(msg.topic_id, 1u);
+  CHECK(!msg.topic_elided);
+  CHECK_EQUAL(encoder.size(), 1u);
+}
+
+TEST(repeated topics go over the wire as IDs) {
+  auto dm = make_data_message("zeek/events/foo", 42);
+  auto [first, first_size] = transmit(make_node_message(dm, 20));
+  auto [second, second_size] = transmit(make_node_message(dm, 20));
+  CHECK_EQUAL(get_topic(first), "zeek/events/foo");
+  CHECK_EQUAL(get_topic(second), "zeek/events/foo");
+  CHECK_EQUAL(get_data(caf::get<data_message>(second.content)), data{42});
+  CHECK_EQUAL(second.ttl, 20u);
+  CHECK_EQUAL(second.topic_id, 0u);
+  CHECK_LESS(second_size, first_size);
+  CHECK_EQUAL(decoder.size(), 1u);
+}
+
+TEST(command messages use the same dictionary) {
+  auto dm = make_data_message("zeek/events/foo", 42);
+  auto cm = make_command_message("zeek/events/foo",
+                                 make_internal_command<clear_command>());
+  transmit(make_node_message(dm, 20));
+  auto [msg, size] = transmit(make_node_message(cm, 20));
+  CHECK(is_command_message(msg));
+  CHECK_EQUAL(get_topic(msg), "zeek/events/foo");
+}
+
+TEST(routing flags survive the wire) {
+  auto dm = make_data_message("zeek/events/foo", 42);
+  auto flags = node_message_flags::none + node_message_flags::no_forward;
+  CHECK(has_node_message_flags(flags, node_message_flags::no_forward));
+  auto [msg, size] = transmit(make_node_message(dm, 20, flags));
+  CHECK(!is_forwardable(msg));
+  auto [fwd, fwd_size] = transmit(make_node_message(dm, 20));
+  CHECK(is_forwardable(fwd));
+}
+
+TEST(decoders reject unknown IDs) {
+  auto msg = make_node_message(make_data_message("zeek/events/foo", 42), 20);
+  msg.content = make_data_message(topic{}, data{42});
+  msg.topic_id = 7;
+  msg.topic_elided = true;
+  CHECK(!decoder.decode(msg));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,74 @@
+#define SUITE topic_index
+
+#include "broker/detail/topic_index.hh"
+
+#include "test.hh"
+
+using namespace broker;
+
+namespace {
+
+using id_list = detail::topic_index::id_list;
+
+struct fixture {
+  detail::topic_index uut;
+
+  fixture() {
+    uut.add(0, filter_type{"zeek/events", "zeek/logs"});
+    uut.add(1, filter_type{"zeek"});
+    uut.add(2, filter_type{"foo/bar"});
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(topic_index_tests, fixture)
+
+TEST(the index returns all IDs with a matching subscription) {
+  CHECK_EQUAL(uut.matches("zeek/events/foo"), id_list({0, 1}));
+  CHECK_EQUAL(uut.matches("zeek/logs"), id_list({0, 1}));
+  CHECK_EQUAL(uut.matches("zeek/stores"), id_list({1}));
+  CHECK_EQUAL(uut.matches("foo/bar/baz"), id_list({2}));
+}
+
+TEST(the index uses the same prefix semantics as topic) {
+  CHECK_EQUAL(uut.matches("zeekfoo"), id_list({1}));
+  CHECK_EQUAL(uut.matches("foo"), id_list());
+  CHECK_EQUAL(uut.matches("bar"), id_list());
+}
+
+TEST(the index reports each ID only once) {
+  uut.add(3, filter_type{"foo", "foo/bar"});
+  CHECK_EQUAL(uut.matches("foo/bar/baz"), id_list({2, 3}));
+}
+
+TEST(the index caches lookups per topic) {
+  CHECK_EQUAL(uut.cache_size(), 0u);
+  CHECK_EQUAL(uut.matches("zeek/events/foo"), id_list({0, 1}));
+  CHECK_EQUAL(uut.matches("zeek/events/foo"), id_list({0, 1}));
+  CHECK_EQUAL(uut.cache_size(), 1u);
+  CHECK_EQUAL(uut.matches("zeek/logs"), id_list({0, 1}));
+  CHECK_EQUAL(uut.cache_size(), 2u);
+}
+
+TEST(adding subscriptions invalidates cached lookups) {
+  CHECK_EQUAL(uut.matches("foo/bar/baz"), id_list({2}));
+  uut.add(3, filter_type{"foo"});
+  CHECK_EQUAL(uut.cache_size(), 0u);
+  CHECK_EQUAL(uut.matches("foo/bar/baz"), id_list({2, 3}));
+}
+
+TEST(the cache never exceeds its maximum size) {
+  auto n = detail::topic_index::max_cache_size;
+  for (size_t i = 0; i < n + 10; ++i)
+    uut.matches("zeek/" + std::to_string(i));
+  CHECK_LESS_EQUAL(uut.cache_size(), n);
+}
+
+TEST(clearing the index drops all subscriptions) {
+  uut.clear();
+  CHECK(uut.empty());
+  CHECK_EQUAL(uut.matches("zeek/events/foo"), id_list());
+}
+
+FIXTURE_SCOPE_END()
@@ -4,6 +4,8 @@
 
 #include "test.hh"
 
+#include <functional>
+#include <memory>
 #include <regex>
 
 #include <caf/test/io_dsl.hpp>
@@ -15,6 +17,8 @@
 #include "broker/error.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal_command.hh"
+#include "broker/detail/master_actor.hh"
+#include "broker/detail/memory_backend.hh"
 #include "broker/store_event.hh"
 #include "broker/topic.hh"
 
@@ -110,6 +114,123 @@ struct fixture : base_fixture {
   }
 };
 
+// Applies all changes immediately like the memory backend, but allows tests
+// to intercept and fail the commit of a batch.
+class test_backend : public memory_backend {
+public:
+  using memory_backend::memory_backend;
+
+  expected<void> commit_batch() override {
+    if (on_commit)
+      on_commit();
+    if (fail_commit)
+      return ec::backend_failure;
+    return {};
+  }
+
+  std::function<void()> on_commit;
+
+  bool fail_commit = false;
+};
+
+struct recorder_state {
+  /// Store events of the master.
+  string_list events;
+
+  /// Sequence numbers of all commands for clones.
+  std::vector<uint64_t> updates;
+
+  /// Responses to put_unique commands.
+  string_list responses;
+
+  static inline const char* name = "recorder";
+};
+
+// Stands in for the core of the master.
+caf::behavior recorder(caf::stateful_actor<recorder_state>* self) {
+  return {
+    [=](atom::publish, command_message& msg, node_message_flags) {
+      self->state.updates.emplace_back(caf::get<1>(msg).seq);
+    },
+    [=](atom::publish, atom::local, data_message& msg) {
+      auto& content = get_data(msg);
+      if (auto ins = store_event::insert::make(content))
+        self->state.events.emplace_back("insert " + to_string(ins.key()));
+      else if (auto upd = store_event::update::make(content))
+        self->state.events.emplace_back("update " + to_string(upd.key()));
+      else if (auto del = store_event::erase::make(content))
+        self->state.events.emplace_back("erase " + to_string(del.key()));
+    },
+    [=](data& x, broker::request_id id) {
+      self->state.responses.emplace_back(std::to_string(id) + " -> "
+                                         + to_string(x));
+    },
+  };
+}
+
+struct batch_config : caf::actor_system_config {
+public:
+  batch_config() {
+    configuration::add_message_types(*this);
+  }
+};
+
+struct batch_fixture : test_coordinator_fixture<batch_config> {
+  // Schedules the reminders for expiring keys via the scheduler of the test.
+  endpoint::clock clock{&sys, true};
+
+  caf::actor core;
+
+  caf::actor master;
+
+  test_backend* backend;
+
+  batch_fixture() {
+    core = sys.spawn(recorder);
+    auto ptr = std::make_unique<test_backend>();
+    backend = ptr.get();
+    master = sys.spawn(master_actor, core, std::string{"foo"},
+                       master_state::backend_pointer{std::move(ptr)}, &clock,
+                       size_t{10});
+    sched.run();
+  }
+
+  ~batch_fixture() {
+    anon_send_exit(master, exit_reason::user_shutdown);
+    anon_send_exit(core, exit_reason::user_shutdown);
+    sched.run();
+  }
+
+  master_state& master_st() {
+    return deref<caf::stateful_actor<master_state>>(master).state;
+  }
+
+  recorder_state& recorded() {
+    return deref<caf::stateful_actor<recorder_state>>(core).state;
+  }
+
+  // Passes `cmds` to the master like a batch from its input stream.
+  void apply(std::vector<internal_command> cmds) {
+    master_st().command(caf::make_span(cmds));
+  }
+
+  internal_command put(data key, data value) {
+    return make_internal_command<put_command>(std::move(key),
+                                              std::move(value));
+  }
+
+  internal_command put_expiring(data key, data value) {
+    return make_internal_command<put_command>(std::move(key),
+                                              std::move(value),
+                                              timespan{std::chrono::hours{1}});
+  }
+
+  internal_command put_unique(data key, data value, broker::request_id id) {
+    return make_internal_command<put_unique_command>(
+      std::move(key), std::move(value), nil, core, id, publisher_id{});
+  }
+};
+
 } // namespace
 
 CAF_TEST_FIXTURE_SCOPE(local_store_master, fixture)
@@ -279,3 +400,94 @@ CAF_TEST(master_with_clone) {
 }
 
 CAF_TEST_FIXTURE_SCOPE_END()
+
+CAF_TEST(change_log) {
+  master_state st;
+  st.change_log_size = 3;
+  CAF_MESSAGE("masters assign sequence numbers even without clones");
+  for (integer i = 0; i < 3; ++i)
+    st.broadcast_cmd_to_clones(erase_command{data{i}, publisher_id{}});
+  CAF_CHECK_EQUAL(st.seq, 3u);
+  CAF_CHECK_EQUAL(st.change_log.size(), 3u);
+  CAF_MESSAGE("clones can catch up from any sequence number in the log");
+  CAF_CHECK(!st.changes_since(0));
+  CAF_CHECK(!st.changes_since(4));
+  CAF_CHECK_EQUAL(st.changes_since(3)->size(), 0u);
+  if (auto delta = st.changes_since(1)) {
+    CAF_REQUIRE_EQUAL(delta->size(), 2u);
+    CAF_CHECK_EQUAL(delta->front().seq, 2u);
+    CAF_CHECK_EQUAL(delta->back().seq, 3u);
+  } else {
+    CAF_FAIL("changes_since(1) returned nil");
+  }
+  CAF_MESSAGE("clones need a snapshot after the log dropped missed commands");
+  st.change_log.pop_front();
+  st.change_log.pop_front();
+  CAF_CHECK(!st.changes_since(1));
+  CAF_CHECK(st.changes_since(2));
+  CAF_MESSAGE("the log keeps at most change_log_size commands");
+  for (integer i = 3; i < 6; ++i)
+    st.broadcast_cmd_to_clones(erase_command{data{i}, publisher_id{}});
+  CAF_CHECK_EQUAL(st.seq, 6u);
+  CAF_REQUIRE_EQUAL(st.change_log.size(), 3u);
+  CAF_CHECK_EQUAL(st.change_log.front().seq, 4u);
+  CAF_CHECK(!st.changes_since(2));
+  CAF_CHECK(st.changes_since(3));
+  CAF_MESSAGE("a capacity of 0 disables the log");
+  st.change_log.clear();
+  st.change_log_size = 0;
+  st.broadcast_cmd_to_clones(erase_command{data{6}, publisher_id{}});
+  CAF_CHECK_EQUAL(st.seq, 7u);
+  CAF_CHECK(st.change_log.empty());
+  CAF_CHECK(!st.changes_since(6));
+}
+
+CAF_TEST_FIXTURE_SCOPE(master_batches, batch_fixture)
+
+CAF_TEST(masters publish the changes of a batch only after committing it) {
+  backend->on_commit = [this] {
+    CAF_MESSAGE("nothing leaves the master before the commit");
+    CAF_CHECK(!sched.has_job());
+    CAF_CHECK(!sched.has_pending_timeout());
+  };
+  apply({put_expiring("a", 1), put_unique("b", 2, 1), put("c", 3)});
+  CAF_CHECK_EQUAL(master_st().seq, 3u);
+  CAF_CHECK_EQUAL(master_st().change_log.size(), 3u);
+  CAF_MESSAGE("the master arms the expiry timer after the commit");
+  CAF_CHECK(sched.has_pending_timeout());
+  sched.run();
+  CAF_CHECK_EQUAL(recorded().updates, std::vector<uint64_t>({1, 2, 3}));
+  CAF_CHECK_EQUAL(recorded().events,
+                  string_list({"insert a", "insert b", "insert c"}));
+  CAF_CHECK_EQUAL(recorded().responses, string_list({"1 -> T"}));
+}
+
+CAF_TEST(masters roll back batches that fail to commit) {
+  apply({put("a", 1), put("b", 2)});
+  sched.run();
+  CAF_REQUIRE_EQUAL(master_st().seq, 2u);
+  recorded().updates.clear();
+  recorded().events.clear();
+  backend->fail_commit = true;
+  apply({put_unique("c", 3, 1), put_expiring("d", 4), put_unique("a", 5, 2),
+         put("b", 6)});
+  CAF_MESSAGE("the master restores its sequence number and change log");
+  CAF_CHECK_EQUAL(master_st().seq, 2u);
+  CAF_REQUIRE_EQUAL(master_st().change_log.size(), 2u);
+  CAF_CHECK_EQUAL(master_st().change_log.back().seq, 2u);
+  CAF_CHECK(master_st().deferred_output.empty());
+  CAF_CHECK(master_st().deferred_reminders.empty());
+  CAF_CHECK(!sched.has_pending_timeout());
+  CAF_MESSAGE("all put_unique requesters receive false");
+  sched.run();
+  CAF_CHECK(recorded().updates.empty());
+  CAF_CHECK(recorded().events.empty());
+  CAF_CHECK_EQUAL(recorded().responses, string_list({"1 -> F", "2 -> F"}));
+  CAF_MESSAGE("the next batch continues after the last committed change");
+  backend->fail_commit = false;
+  apply({put("e", 7), put("f", 8)});
+  sched.run();
+  CAF_CHECK_EQUAL(recorded().updates, std::vector<uint64_t>({3, 4}));
+}
+
+CAF_TEST_FIXTURE_SCOPE_END()
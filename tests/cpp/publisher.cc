@@ -123,7 +123,26 @@ CAF_TEST(blocking_publishers) {
         CAF_REQUIRE_EQUAL(xs, expected);
       }
     );
+    CAF_MESSAGE("the endpoint reports the metrics of both publishers");
+    auto metrics = ep.metrics();
+    auto find = [&](const std::string& name) -> const queue_metrics* {
+      for (auto& x : metrics)
+        if (x.name == name)
+          return &x;
+      return nullptr;
+    };
+    auto m1 = find("publisher a");
+    auto m2 = find("publisher a/b");
+    CAF_REQUIRE(m1 != nullptr && m2 != nullptr);
+    CAF_CHECK_EQUAL(m1->enqueued, 4u);
+    CAF_CHECK_EQUAL(m1->dequeued, 4u);
+    CAF_CHECK_EQUAL(m2->enqueued, 3u);
+    CAF_CHECK_EQUAL(m2->dequeued, 3u);
+    CAF_CHECK_EQUAL(m2->buffered, 0u);
   }
+  run();
+  CAF_MESSAGE("the endpoint forgets the metrics of destroyed publishers");
+  CAF_CHECK(ep.metrics().empty());
   // Shutdown.
   CAF_MESSAGE("Shutdown core actors.");
   anon_send_exit(core1, exit_reason::user_shutdown);
@@ -187,4 +206,30 @@ CAF_TEST(nonblocking_publishers) {
   anon_send_exit(leaf, exit_reason::user_shutdown);
 }
 
+CAF_TEST(adaptive_publisher_queue) {
+  auto q = make_shared_publisher_queue(4, 16);
+  auto fill = [&](size_t n) {
+    std::vector<data> xs(n, data{42});
+    q->produce(topic{"a"}, xs.begin(), xs.end());
+  };
+  auto drop = [](data_message&&) {};
+  CAF_MESSAGE("draining a full queue completely doubles its capacity");
+  fill(4);
+  CAF_CHECK_EQUAL(q->consume(10, drop), 4u);
+  CAF_CHECK_EQUAL(q->capacity(), 8u);
+  fill(8);
+  CAF_CHECK_EQUAL(q->consume(10, drop), 8u);
+  CAF_CHECK_EQUAL(q->capacity(), 16u);
+  CAF_MESSAGE("the capacity never exceeds the maximum");
+  fill(16);
+  CAF_CHECK_EQUAL(q->consume(20, drop), 16u);
+  CAF_CHECK_EQUAL(q->capacity(), 16u);
+  CAF_MESSAGE("draining only parts of the queue keeps the capacity");
+  auto q2 = make_shared_publisher_queue(4, 16);
+  std::vector<data> xs(4, data{42});
+  q2->produce(topic{"a"}, xs.begin(), xs.end());
+  CAF_CHECK_EQUAL(q2->consume(2, drop), 2u);
+  CAF_CHECK_EQUAL(q2->capacity(), 4u);
+}
+
 CAF_TEST_FIXTURE_SCOPE_END()
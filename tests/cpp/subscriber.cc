@@ -22,6 +22,7 @@
 #include "broker/endpoint.hh"
 #include "broker/filter_type.hh"
 #include "broker/message.hh"
+#include "broker/sharded_subscriber.hh"
 #include "broker/topic.hh"
 
 using std::cout;
@@ -99,6 +100,158 @@ CAF_TEST(blocking_subscriber) {
   anon_send_exit(d1, exit_reason::user_shutdown);
 }
 
+CAF_TEST(subscriber_with_caller_buffers) {
+  // Spawn/get/configure core actors.
+  broker_options options;
+  options.disable_ssl = true;
+  auto core1 = sys.spawn(core_actor, filter_type{"a", "b", "c"}, options, nullptr);
+  auto core2 = ep.core();
+  anon_send(core2, atom::subscribe_v, filter_type{"a", "b", "c"});
+  anon_send(core1, atom::no_events_v);
+  anon_send(core2, atom::no_events_v);
+  run();
+  // Connect a subscriber (leaf) to core2.
+  auto sub = ep.make_subscriber(filter_type{"b"});
+  sub.set_rate_calculation(false);
+  auto leaf = sub.worker();
+  CAF_MESSAGE("core1: " << to_string(core1));
+  CAF_MESSAGE("core2: " << to_string(core2));
+  CAF_MESSAGE("leaf: " << to_string(leaf));
+  // Initiate handshake between core1 and core2.
+  self->send(core1, atom::peer_v, core2);
+  run();
+  // Spin up driver on core1.
+  auto d1 = sys.spawn(driver, core1);
+  CAF_MESSAGE("driver: " << to_string(d1));
+  run();
+  CAF_MESSAGE("move values from the subscriber's buffer into our buffer");
+  std::vector<data_message> xs;
+  xs.reserve(4);
+  CAF_CHECK_EQUAL(sub.get_into(xs, 2), 2u);
+  CAF_CHECK_EQUAL(xs, data_msgs({{"b", true}, {"b", false}}));
+  CAF_CHECK_EQUAL(sub.poll_into(xs), 2u);
+  CAF_CHECK_EQUAL(xs, data_msgs({{"b", true}, {"b", false},
+                                 {"b", true}, {"b", false}}));
+  CAF_MESSAGE("consume on an empty buffer returns immediately");
+  size_t consumed = 0;
+  CAF_CHECK_EQUAL(sub.consume([&](data_message&&) { ++consumed; }), 0u);
+  CAF_CHECK_EQUAL(consumed, 0u);
+  // Shutdown.
+  CAF_MESSAGE("Shutdown core actors.");
+  anon_send_exit(core1, exit_reason::user_shutdown);
+  anon_send_exit(core2, exit_reason::user_shutdown);
+  anon_send_exit(leaf, exit_reason::user_shutdown);
+  anon_send_exit(d1, exit_reason::user_shutdown);
+}
+
+CAF_TEST(lock_free_subscriber) {
+  // Spawn/get/configure core actors.
+  broker_options options;
+  options.disable_ssl = true;
+  auto core1 = sys.spawn(core_actor, filter_type{"a", "b", "c"}, options, nullptr);
+  auto core2 = ep.core();
+  anon_send(core2, atom::subscribe_v, filter_type{"a", "b", "c"});
+  anon_send(core1, atom::no_events_v);
+  anon_send(core2, atom::no_events_v);
+  run();
+  // Connect a subscriber with a lock-free queue (leaf) to core2.
+  auto sub = ep.make_subscriber(filter_type{"b"}, 20, queue_kind::lock_free);
+  sub.set_rate_calculation(false);
+  auto leaf = sub.worker();
+  CAF_MESSAGE("core1: " << to_string(core1));
+  CAF_MESSAGE("core2: " << to_string(core2));
+  CAF_MESSAGE("leaf: " << to_string(leaf));
+  // Initiate handshake between core1 and core2.
+  self->send(core1, atom::peer_v, core2);
+  run();
+  // Spin up driver on core1.
+  auto d1 = sys.spawn(driver, core1);
+  CAF_MESSAGE("driver: " << to_string(d1));
+  run();
+  CAF_MESSAGE("check content of the subscriber's buffer");
+  auto expected = data_msgs({{"b", true}, {"b", false},
+                             {"b", true}, {"b", false}});
+  CAF_CHECK_EQUAL(sub.poll(), expected);
+  // Shutdown.
+  CAF_MESSAGE("Shutdown core actors.");
+  anon_send_exit(core1, exit_reason::user_shutdown);
+  anon_send_exit(core2, exit_reason::user_shutdown);
+  anon_send_exit(leaf, exit_reason::user_shutdown);
+  anon_send_exit(d1, exit_reason::user_shutdown);
+}
+
+CAF_TEST(dropping_subscriber) {
+  // Spawn/get/configure core actors.
+  broker_options options;
+  options.disable_ssl = true;
+  auto core1 = sys.spawn(core_actor, filter_type{"a", "b", "c"}, options, nullptr);
+  auto core2 = ep.core();
+  anon_send(core2, atom::subscribe_v, filter_type{"a", "b", "c"});
+  anon_send(core1, atom::no_events_v);
+  anon_send(core2, atom::no_events_v);
+  run();
+  // Connect a subscriber (leaf) to core2 that buffers at most two messages
+  // and drops everything else.
+  auto sub = ep.make_subscriber(filter_type{"b"}, 2, queue_kind::locked,
+                                overflow_policy::drop_newest);
+  sub.set_rate_calculation(false);
+  auto leaf = sub.worker();
+  CAF_CHECK(sub.policy() == overflow_policy::drop_newest);
+  // Initiate handshake between core1 and core2.
+  self->send(core1, atom::peer_v, core2);
+  run();
+  // Spin up driver on core1.
+  auto d1 = sys.spawn(driver, core1);
+  run();
+  CAF_MESSAGE("the subscriber keeps the first two messages");
+  auto expected = data_msgs({{"b", true}, {"b", false}});
+  CAF_CHECK_EQUAL(sub.poll(), expected);
+  CAF_CHECK_EQUAL(sub.dropped(), 2u);
+  // Shutdown.
+  CAF_MESSAGE("Shutdown core actors.");
+  anon_send_exit(core1, exit_reason::user_shutdown);
+  anon_send_exit(core2, exit_reason::user_shutdown);
+  anon_send_exit(leaf, exit_reason::user_shutdown);
+  anon_send_exit(d1, exit_reason::user_shutdown);
+}
+
+CAF_TEST(sharded_subscriber) {
+  // Spawn/get/configure core actors.
+  broker_options options;
+  options.disable_ssl = true;
+  auto core1 = sys.spawn(core_actor, filter_type{"a", "b", "c"}, options, nullptr);
+  auto core2 = ep.core();
+  anon_send(core2, atom::subscribe_v, filter_type{"a", "b", "c"});
+  anon_send(core1, atom::no_events_v);
+  anon_send(core2, atom::no_events_v);
+  run();
+  // Connect a subscriber (leaf) to core2 that routes topic "a" to the first
+  // shard and topic "b" to the second shard.
+  auto route = [](const topic& t) -> size_t { return t.string() == "a" ? 0 : 1; };
+  auto sub = ep.make_sharded_subscriber(filter_type{"a", "b"}, 2, route, 20);
+  auto leaf = sub.worker();
+  CAF_REQUIRE_EQUAL(sub.size(), 2u);
+  CAF_CHECK_NOT_EQUAL(sub[0].fd(), sub[1].fd());
+  // Initiate handshake between core1 and core2.
+  self->send(core1, atom::peer_v, core2);
+  run();
+  // Spin up driver on core1.
+  auto d1 = sys.spawn(driver, core1);
+  run();
+  CAF_MESSAGE("each shard receives the messages for its topic in order");
+  CAF_CHECK_EQUAL(sub[0].poll(),
+                  data_msgs({{"a", 0}, {"a", 1}, {"a", 2}, {"a", 3}, {"a", 4},
+                             {"a", 5}}));
+  CAF_CHECK_EQUAL(sub[1].poll(), data_msgs({{"b", true}, {"b", false},
+                                            {"b", true}, {"b", false}}));
+  // Shutdown.
+  CAF_MESSAGE("Shutdown core actors.");
+  anon_send_exit(core1, exit_reason::user_shutdown);
+  anon_send_exit(core2, exit_reason::user_shutdown);
+  anon_send_exit(leaf, exit_reason::user_shutdown);
+  anon_send_exit(d1, exit_reason::user_shutdown);
+}
+
 CAF_TEST(nonblocking_subscriber) {
   // Spawn/get/configure core actors.
   broker_options options;
@@ -88,3 +88,44 @@ TEST(prefix) {
   CAF_CHECK( t5.prefix_of(t4));
   CAF_CHECK( t5.prefix_of(t5));
 }
+
+TEST(interning) {
+  topic t0 = "/zeek/events/";
+  topic t1 = "/zeek/events/";
+  topic t2 = "/zeek/";
+  CHECK_EQUAL(t0.id(), 0u);
+  CHECK(t0.intern());
+  CHECK(t1.intern());
+  CHECK(t2.intern());
+  CHECK_NOT_EQUAL(t0.id(), 0u);
+  CHECK_EQUAL(t0.id(), t1.id());
+  CHECK_NOT_EQUAL(t0.id(), t2.id());
+  CHECK_EQUAL(t0.string(), "/zeek/events/");
+  // Interned and regular topics are interchangeable.
+  topic t3 = "/zeek/events/";
+  CHECK_EQUAL(t0, t3);
+  CHECK_EQUAL(std::hash<topic>{}(t0), std::hash<topic>{}(t3));
+  CHECK(t2.prefix_of(t0));
+  CHECK(t2.prefix_of(t3));
+  CHECK(!t0.prefix_of(t2));
+  CHECK(topic::split(t0) == topic::split(t3));
+  // Modifying an interned topic turns it into a regular topic.
+  t0 /= "foo";
+  CHECK_EQUAL(t0.id(), 0u);
+  CHECK_EQUAL(t0, "/zeek/events/foo");
+}
+
+TEST(appending interned topics) {
+  topic suffix = "events";
+  CHECK(suffix.intern());
+  topic t0 = "/zeek";
+  CHECK_EQUAL(t0 / suffix, "/zeek/events");
+  t0 /= suffix;
+  CHECK_EQUAL(t0, "/zeek/events");
+  topic t1 = "/zeek";
+  CHECK(t1.intern());
+  CHECK_EQUAL(t1 / suffix, "/zeek/events");
+  MESSAGE("appending an interned topic to itself");
+  t1 /= t1;
+  CHECK_EQUAL(t1, "/zeek/zeek");
+}